@@ -0,0 +1,81 @@
+/*
+batchTest.cpp
+
+Checks order of batch operations over loopback: reads see writes added before them, read overlapping
+write added after it is rejected, non-overlapping entries are not affected. Returns non-zero on failure.
+
+Usage: batchTest
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 64;
+static const uint32_t REQUEST_BUFFER_SIZE = 256;
+
+static bool check(bool condition, const char *description) {
+	if (!condition) {
+		printf("FAILED: %s\n", description);
+	}
+	return condition;
+}
+
+int main() {
+	static uint8_t memory[MEMORY_SIZE], requestBuffer[REQUEST_BUFFER_SIZE];
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.enableExtendedFrames(requestBuffer, REQUEST_BUFFER_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackMaster master;
+	bool ok = true;
+
+	// Read followed by overlapping write would return the new value.
+	memory[5] = 1;
+	uint8_t value = 2, readBefore = 0xFF, readAfter = 0, readOther = 0;
+	memory[20] = 7;
+
+	CommBatch batch;
+	batch.read(4, &readBefore, 2);
+	batch.write(5, &value, 1);
+	batch.read(5, &readAfter, 1);
+	batch.read(20, &readOther, 1);
+
+	ok = check(master.execute(slavePtr, batch) == Ok, "batch frame status") && ok;
+	ok = check(batch.getStatus(0) == ErrInvalidRequest, "read overlapping later write is rejected") && ok;
+	ok = check(batch.getStatus(1) == Ok, "write status") && ok;
+	ok = check(memory[5] == 2, "write applied") && ok;
+	ok = check( (batch.getStatus(2) == Ok) && (readAfter == 2), "read sees earlier write") && ok;
+	ok = check( (batch.getStatus(3) == Ok) && (readOther == 7), "unrelated read") && ok;
+
+	// Adjacent ranges do not overlap.
+	uint8_t adjacent[2] = {}, data[2] = {3, 4};
+	batch.clear();
+	batch.read(10, adjacent, 2);
+	batch.write(12, data, 2);
+	batch.write(8, data, 2);
+
+	ok = check(master.execute(slavePtr, batch) == Ok, "adjacent batch frame status") && ok;
+	ok = check(batch.getStatus(0) == Ok, "read adjacent to later writes") && ok;
+
+	if (ok) {
+		printf("batch order: ok\n");
+	}
+
+	return ok ? 0 : 1;
+}
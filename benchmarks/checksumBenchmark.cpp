@@ -0,0 +1,155 @@
+/*
+checksumBenchmark.cpp
+
+Compares throughput of available checksum engines and verifies that all engines
+of the same checksum produce identical results.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "CommChecksum.hpp"
+
+static uint8_t bitwiseEngine(const uint8_t *data, uint32_t size) {
+	uint8_t checksum = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		checksum = calculateChecksumBitwise(checksum, data[i]);
+	}
+	return checksum;
+}
+
+static uint8_t tableEngine(const uint8_t *data, uint32_t size) {
+	uint8_t checksum = 0;
+	for (uint32_t i = 0; i < size; i++) {
+		checksum = calculateChecksumTable(checksum, data[i]);
+	}
+	return checksum;
+}
+
+static uint8_t slicing4Engine(const uint8_t *data, uint32_t size) {
+	return calculateChecksumSlicing<4>(data, size, 0);
+}
+
+static uint8_t slicing8Engine(const uint8_t *data, uint32_t size) {
+	return calculateChecksumSlicing<8>(data, size, 0);
+}
+
+static uint32_t crc16Engine(const uint8_t *data, uint32_t size) {
+	return checksumUpdate(ChecksumCRC16, checksumInit(ChecksumCRC16), data, size);
+}
+
+static uint32_t crc32cTableEngine(const uint8_t *data, uint32_t size) {
+	return calculateCrc32cTable(data, size, 0xFFFFFFFF) ^ 0xFFFFFFFF;
+}
+
+#if EMBEDDEDCOMM_CRC32C_HW
+static uint32_t crc32cHardwareEngine(const uint8_t *data, uint32_t size) {
+	if (!crc32cHardwareUsable()) {
+		return crc32cTableEngine(data, size);
+	}
+
+	return calculateCrc32cHardware(data, size, 0xFFFFFFFF) ^ 0xFFFFFFFF;
+}
+#endif
+
+struct Engine {
+	const char *name;
+	uint8_t (*run)(const uint8_t*, uint32_t);
+};
+
+static const Engine engines[] = {
+	{"bitwise", bitwiseEngine},
+	{"table", tableEngine},
+	{"slicing-by-4", slicing4Engine},
+	{"slicing-by-8", slicing8Engine},
+};
+
+struct WideEngine {
+	const char *name;
+	uint32_t (*run)(const uint8_t*, uint32_t);
+};
+
+static const WideEngine crc32cEngines[] = {
+	{"crc32c-table", crc32cTableEngine},
+#if EMBEDDEDCOMM_CRC32C_HW
+	{"crc32c-hw", crc32cHardwareEngine},
+#endif
+};
+
+template <typename T>
+static void measure(const char *name, T (*run)(const uint8_t*, uint32_t), const std::vector<uint8_t> &buffer, uint32_t repeats) {
+	T checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < repeats; i++) {
+		checksum = run(buffer.data(), buffer.size());
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	double mbs = (double)buffer.size() * repeats / elapsed.count() / 1e6;
+	printf("%-14s %10.1f %10x\n", name, mbs, (uint32_t)checksum);
+}
+
+int main() {
+	const uint32_t bufferSize = 1 << 20;
+	const uint32_t repeats = 64;
+	std::vector<uint8_t> buffer(bufferSize);
+
+	srand(1);
+	for (auto &b : buffer) {
+		b = (uint8_t)rand();
+	}
+
+	// Every engine must match bitwise reference for all sizes and alignments.
+	for (uint32_t offset = 0; offset < 8; offset++) {
+		for (uint32_t size = 0; size < 300; size++) {
+			uint8_t expected = bitwiseEngine(&buffer[offset], size);
+			for (const Engine &engine : engines) {
+				if (engine.run(&buffer[offset], size) != expected) {
+					printf("%s mismatch (offset %u, size %u)\n", engine.name, offset, size);
+					return 1;
+				}
+			}
+
+			uint32_t expectedWide = crc32cTableEngine(&buffer[offset], size);
+			for (const WideEngine &engine : crc32cEngines) {
+				if (engine.run(&buffer[offset], size) != expectedWide) {
+					printf("%s mismatch (offset %u, size %u)\n", engine.name, offset, size);
+					return 1;
+				}
+			}
+		}
+	}
+
+#if EMBEDDEDCOMM_CRC32C_HW
+	if (!crc32cHardwareUsable()) {
+		printf("CPU does not support hardware CRC32C, table is used\n");
+	}
+#endif
+
+	printf("%-14s %10s %10s\n", "engine", "MB/s", "crc");
+	for (const Engine &engine : engines) {
+		measure(engine.name, engine.run, buffer, repeats);
+	}
+
+	measure("crc16", crc16Engine, buffer, repeats);
+	for (const WideEngine &engine : crc32cEngines) {
+		measure(engine.name, engine.run, buffer, repeats);
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+dirtyBenchmark.cpp
+
+Compares polling whole slave memory map with polling only pages changed since previous cycle
+(dirty page tracking): bytes on wire per cycle and cycles/s over simulated 400 kHz I2C.
+
+Usage: dirtyBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 4096;
+static const uint32_t PAGE_SIZE = 32;
+static const uint32_t NUMBER_OF_PAGES = MEMORY_SIZE / PAGE_SIZE;
+static const uint32_t CYCLES = 200;
+static const uint32_t CHANGED_PAGES[] = {0, 1, 4, 16, 64};
+
+// Slave application updates some values in random pages and rewrites a few unchanged ones,
+// master refreshes its mirror. Returns bytes on wire per cycle, or 0 if mirror differs from slave's memory.
+static double measure(bool dirtyPolling, uint32_t changedPages) {
+	// Slave's memory has one spare page after polled map, as frame header check keeps read() from its last byte.
+	static uint8_t memory[MEMORY_SIZE + PAGE_SIZE], mirror[MEMORY_SIZE], requestBuffer[MAX_BATCH_ENTRIES * BATCH_ENTRY_HEADER_SIZE], dirtyFlags[NUMBER_OF_PAGES];
+
+	srand(1);
+	for (uint32_t i = 0; i < MEMORY_SIZE; i++) {
+		memory[i] = (uint8_t)rand();
+	}
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE + PAGE_SIZE);
+	slave.enableExtendedFrames(requestBuffer, sizeof(requestBuffer));
+	slave.enableDirtyTracking(dirtyFlags, NUMBER_OF_PAGES + 1, PAGE_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackMaster master;
+
+	// Initial full read is not measured.
+	if (master.readDirtyPages(slavePtr, 0, MEMORY_SIZE, PAGE_SIZE, mirror) != Ok) {
+		return 0;
+	}
+	const uint64_t startBytes = master.getBytesOnWire();
+
+	for (uint32_t cycle = 0; cycle < CYCLES; cycle++) {
+		for (uint32_t i = 0; i < changedPages; i++) {
+			uint32_t value = rand();
+			slave.writeMemory((rand() % NUMBER_OF_PAGES) * PAGE_SIZE + 8, (uint8_t *)&value, sizeof(value));
+		}
+
+		// Periodic rewrite of configuration values, which do not change.
+		slave.writeMemory(0, &memory[0], 64);
+
+		StatusValue status = dirtyPolling ? master.readDirtyPages(slavePtr, 0, MEMORY_SIZE, PAGE_SIZE, mirror) :
+			master.read(slavePtr, 0, mirror, MEMORY_SIZE);
+		if (status != Ok) {
+			return 0;
+		}
+	}
+
+	if (memcmp(memory, mirror, MEMORY_SIZE) != 0) {
+		return 0;
+	}
+
+	return (double)(master.getBytesOnWire() - startBytes) / CYCLES;
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	uint64_t bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("map: %u B, %u B pages, bus: %llu B/s\n", MEMORY_SIZE, PAGE_SIZE, (unsigned long long)bytesPerSecond);
+	printf("%13s | %16s | %16s | %7s\n", "changed pages", "full poll", "dirty pages", "traffic");
+	printf("%13s | %7s %8s | %7s %8s | %7s\n", "per cycle", "B/cycle", "cycles/s", "B/cycle", "cycles/s", "less");
+
+	for (uint32_t changedPages : CHANGED_PAGES) {
+		const double full = measure(false, changedPages);
+		const double dirty = measure(true, changedPages);
+
+		if ( (full == 0) || (dirty == 0) ) {
+			printf("polling with %u changed pages failed\n", changedPages);
+			return 1;
+		}
+
+		printf("%13u | %7.0f %8.1f | %7.0f %8.1f | %6.1fx\n", changedPages, full, bytesPerSecond / full,
+			dirty, bytesPerSecond / dirty, full / dirty);
+	}
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+handlerBenchmark.cpp
+
+Compares GenericSlave per-byte handlers with block handlers for write and read frames
+and verifies that both produce identical results. Then measures per-byte writes to memory
+sharing callback filter pages with growing number of long range callbacks below it.
+Built with EMBEDDEDCOMM_MAX_MEMORY_CHANGE_CALLBACKS=256.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "GenericSlave.hpp"
+
+static const uint32_t MEMORY_SIZE = 1 << 15;
+static const uint32_t TRANSFER_SIZES[] = {64, 1024, 16384};
+static const uint32_t PACKET_SIZE = 64; // Block handlers are fed with USB sized packets.
+static const uint32_t LONG_CALLBACKS[] = {1, 8, 64, 256};
+static const uint32_t CALLBACK_WRITE_SIZE = 1024;
+static const uint32_t CALLBACK_FILTER_SIZE = (CALLBACK_FILTER_WORDS * 32) << CALLBACK_FILTER_PAGE_SHIFT; // Bytes hashed to distinct pages.
+
+struct TestSlave {
+	TestSlave(): memory(MEMORY_SIZE), backup(MEMORY_SIZE) {
+		slave.initialize(memory.data(), MEMORY_SIZE);
+		slave.enableMemBackups(backup.data(), MEMORY_SIZE);
+	}
+
+	GenericSlave slave;
+	std::vector<uint8_t> memory;
+	std::vector<uint8_t> backup;
+};
+
+// Build frame sent by master: header, payload (write only) and checksum (write only).
+static std::vector<uint8_t> buildFrame(bool read, uint32_t address, const uint8_t *data, uint32_t size, bool corrupt) {
+	std::vector<uint8_t> frame(SLAVE_ADDRESS_SIZE * 2);
+	uint32_t lengthField = size | (read ? READ_FLAG : 0);
+	memcpy(&frame[0], &lengthField, SLAVE_ADDRESS_SIZE);
+	memcpy(&frame[SLAVE_ADDRESS_SIZE], &address, SLAVE_ADDRESS_SIZE);
+
+	if (!read) {
+		frame.resize(SLAVE_ADDRESS_SIZE * 2 + size);
+		memcpy(&frame[SLAVE_ADDRESS_SIZE * 2], data, size);
+		frame.push_back(calculateChecksum(frame.data(), frame.size()) ^ (corrupt ? 1 : 0));
+	}
+
+	return frame;
+}
+
+// Pass frame to slave and collect response (data, checksum and status).
+static std::vector<uint8_t> transaction(GenericSlave &slave, const std::vector<uint8_t> &frame, uint32_t responseSize, bool block) {
+	std::vector<uint8_t> response(responseSize);
+
+	if (block) {
+		for (uint32_t i = 0; i < frame.size(); i += PACKET_SIZE) {
+			slave.writeHandler(&frame[i], std::min<uint32_t>(PACKET_SIZE, frame.size() - i));
+		}
+		for (uint32_t i = 0; i < responseSize; i += PACKET_SIZE) {
+			slave.readHandler(&response[i], std::min<uint32_t>(PACKET_SIZE, responseSize - i));
+		}
+	} else {
+		for (uint8_t b : frame) {
+			slave.writeHandler(b);
+		}
+		for (uint8_t &b : response) {
+			b = slave.readHandler();
+		}
+	}
+
+	slave.process();
+	return response;
+}
+
+// Run the same sequence of valid and invalid frames on both handler variants.
+static bool verify() {
+	TestSlave perByte, block;
+	std::vector<uint8_t> data(MEMORY_SIZE);
+	for (auto &b : data) {
+		b = (uint8_t)rand();
+	}
+
+	struct Case { bool read; uint32_t address; uint32_t size; bool corrupt; };
+	const Case cases[] = {
+		{false, 0, 1000, false}, {true, 0, 1000, false}, {false, 10, 300, true}, {true, 10, 300, false},
+		{false, MEMORY_SIZE - 100, 200, false}, {true, MEMORY_SIZE - 100, 200, false}, {false, 5, 77, false},
+		{true, MEMORY_SIZE - 10, 9, false}, {true, 7, 4000, false}, {false, 100, 0, false}, {true, 3, 1, false},
+	};
+
+	for (const Case &c : cases) {
+		std::vector<uint8_t> frame = buildFrame(c.read, c.address, data.data() + c.address % 1000, c.size, c.corrupt);
+		uint32_t responseSize = c.read ? c.size + 2 : 1;
+
+		if (transaction(perByte.slave, frame, responseSize, false) != transaction(block.slave, frame, responseSize, true)) {
+			printf("response mismatch (read %d, address %u, size %u)\n", c.read, c.address, c.size);
+			return false;
+		}
+
+		if (perByte.memory != block.memory) {
+			printf("memory mismatch (read %d, address %u, size %u)\n", c.read, c.address, c.size);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static double measure(bool read, uint32_t size, bool block) {
+	TestSlave t;
+	std::vector<uint8_t> data(size, 0x5A);
+	std::vector<uint8_t> frame = buildFrame(read, 0, data.data(), size, false);
+	uint32_t responseSize = read ? size + 2 : 1;
+	const uint32_t repeats = (1 << 24) / size + 10;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < repeats; i++) {
+		transaction(t.slave, frame, responseSize, block);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return (double)size * repeats / elapsed.count() / 1e6;
+}
+
+static void longCallback(uint32_t, uint32_t, void *) {}
+
+// Per-byte write frames three filter sizes into memory, returns the best ns/byte of three runs. Long callbacks
+// watch ranges starting at 16 byte steps below one filter size and ending together before written span. Each of
+// them hashes to all pages of written span, so every written byte passes the filter while no callback overlaps it.
+static double measureCallbacks(uint32_t numberOfCallbacks) {
+	TestSlave t;
+	for (uint32_t i = 0; i < numberOfCallbacks; i++) {
+		t.slave.addMemoryChangeCallback(CALLBACK_FILTER_SIZE - i * 16, CALLBACK_WRITE_SIZE + i * 16, longCallback);
+	}
+
+	std::vector<uint8_t> data(CALLBACK_WRITE_SIZE);
+	std::vector<uint8_t> frames[2];
+	for (uint32_t i = 0; i < 2; i++) {
+		// Alternate contents, so every byte changes.
+		std::fill(data.begin(), data.end(), (uint8_t)(0x5A + i));
+		frames[i] = buildFrame(false, 3 * CALLBACK_FILTER_SIZE, data.data(), CALLBACK_WRITE_SIZE, false);
+	}
+	const uint32_t repeats = (1 << 22) / CALLBACK_WRITE_SIZE;
+	double best = 0;
+
+	for (uint32_t run = 0; run < 3; run++) {
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < repeats; i++) {
+			transaction(t.slave, frames[i % 2], 1, false);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		const double nsPerByte = elapsed.count() * 1e9 / ((double)CALLBACK_WRITE_SIZE * repeats);
+		best = ( (run == 0) || (nsPerByte < best) ) ? nsPerByte : best;
+	}
+
+	return best;
+}
+
+int main() {
+	if (!verify()) {
+		return 1;
+	}
+
+	printf("%-6s %8s %14s %14s %8s\n", "op", "size", "per-byte MB/s", "block MB/s", "speedup");
+	for (uint32_t size : TRANSFER_SIZES) {
+		for (bool read : {false, true}) {
+			double perByte = measure(read, size, false);
+			double block = measure(read, size, true);
+			printf("%-6s %8u %14.1f %14.1f %7.1fx\n", read ? "read" : "write", size, perByte, block, block / perByte);
+		}
+	}
+
+	printf("\n%-15s %14s\n", "long callbacks", "ns/byte");
+	for (uint32_t numberOfCallbacks : LONG_CALLBACKS) {
+		if (numberOfCallbacks <= MAX_MEMORY_CHANGE_CALLBACKS) {
+			printf("%-15u %14.2f\n", numberOfCallbacks, measureCallbacks(numberOfCallbacks));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+headerBenchmark.cpp
+
+Compares fixed and varint header encodings on typical register-poll traffic:
+bytes on wire per transaction and resulting transaction rate on 400 kHz I2C bus.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 4096;
+static const uint32_t TRANSACTIONS = 10000;
+static const double I2C_BYTES_PER_SECOND = 44444; // 400 kHz, 9 clocks per byte.
+
+struct Access {
+	bool read;
+	uint32_t address;
+	uint32_t size;
+};
+
+struct Pattern {
+	const char *name;
+	Access (*next)(uint32_t i);
+};
+
+// Mixed poll: mostly short status reads of low registers, some setpoint writes, occasional block read of far memory.
+static Access mixedAccess(uint32_t) {
+	const uint32_t r = rand();
+
+	switch (r % 10) {
+	case 0:
+		return {true, (r >> 8) % (MEMORY_SIZE - 16), 16};
+	case 1:
+	case 2:
+		return {false, (r >> 8) % 512, 2};
+	default:
+		return {true, (r >> 8) % 128, 1 + (r >> 16) % 4};
+	}
+}
+
+static const Pattern PATTERNS[] = {
+	{"status read 1B @0x10", [](uint32_t) { return Access{true, 0x10, 1}; }},
+	{"sensor read 8B @0x40", [](uint32_t) { return Access{true, 0x40, 8}; }},
+	{"setpoint write 2B @0x100", [](uint32_t) { return Access{false, 0x100, 2}; }},
+	{"config read 4B @0xF00", [](uint32_t) { return Access{true, 0xF00, 4}; }},
+	{"mixed poll", mixedAccess}
+};
+
+// Average number of bytes on wire per transaction of given pattern.
+template <typename Profile>
+static bool measure(const Pattern &pattern, HeaderEncoding encoding, double &bytesPerTransaction) {
+	static uint8_t memory[MEMORY_SIZE];
+	uint8_t buffer[16] = {};
+
+	BasicGenericSlave<Profile> slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.setHeaderEncoding(encoding);
+	BasicGenericSlave<Profile> *slavePtr = &slave;
+
+	BasicLoopbackMaster<Profile> master;
+	master.setHeaderEncoding(encoding);
+
+	// Both encodings see the same sequence.
+	srand(1);
+
+	for (uint32_t i = 0; i < TRANSACTIONS; i++) {
+		Access access = pattern.next(i);
+		StatusValue status = access.read ? master.read(slavePtr, access.address, buffer, access.size) :
+			master.write(slavePtr, access.address, buffer, access.size);
+
+		if (status != Ok) {
+			return false;
+		}
+	}
+
+	bytesPerTransaction = (double)master.getBytesOnWire() / TRANSACTIONS;
+	return true;
+}
+
+int main() {
+	printf("CRC8, transaction rate on 400 kHz I2C bus\n");
+	printf("%-26s | %-24s | %-24s\n", "", "default profile (4+4)", "compact profile (2+2)");
+	printf("%-26s | %5s %6s %10s | %5s %6s %10s\n", "pattern", "fixed", "varint", "trans/s", "fixed", "varint", "trans/s");
+
+	for (const Pattern &pattern : PATTERNS) {
+		double bytes[4];
+
+		bool ok = measure<DefaultProfile>(pattern, HeaderFixed, bytes[0]) &&
+			measure<DefaultProfile>(pattern, HeaderVarint, bytes[1]) &&
+			measure<CompactProfile>(pattern, HeaderFixed, bytes[2]) &&
+			measure<CompactProfile>(pattern, HeaderVarint, bytes[3]);
+
+		if (!ok) {
+			printf("%s failed\n", pattern.name);
+			return 1;
+		}
+
+		printf("%-26s | %5.1f %6.1f %4.0f->%-5.0f | %5.1f %6.1f %4.0f->%-5.0f\n", pattern.name,
+			bytes[0], bytes[1], I2C_BYTES_PER_SECOND / bytes[0], I2C_BYTES_PER_SECOND / bytes[1],
+			bytes[2], bytes[3], I2C_BYTES_PER_SECOND / bytes[2], I2C_BYTES_PER_SECOND / bytes[3]);
+	}
+
+	return 0;
+}
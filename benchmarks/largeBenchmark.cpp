@@ -0,0 +1,134 @@
+/*
+largeBenchmark.cpp
+
+Master writes and reads back 8 KB image of slave's memory: bytes on wire, transfers and resulting KB/s
+over simulated 400 kHz I2C, when application splits it into fixed 32 byte writes and when writeLarge()
+and readLarge() split it according to slave's limits. Slaves differ in buffers limiting their writes.
+
+Usage: largeBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 16384;
+static const uint32_t IMAGE_ADDRESS = 0x100;
+static const uint32_t IMAGE_SIZE = 8192;
+static const uint32_t APPLICATION_CHUNK = 32; // Write size application knows to be safe for any slave.
+
+// Buffers of slave: backup, staging and request buffer sizes (0 if disabled).
+struct SlaveConfig {
+	const char *name;
+	uint32_t backupSize;
+	uint32_t stagingSize;
+	uint32_t requestSize;
+};
+
+static const SlaveConfig CONFIGS[] = {
+	{"backup 64 B", 64, 0, 0},
+	{"backup 64 B, request 1 KB", 64, 0, 1024},
+	{"staging 512 B", 0, 512, 0},
+	{"no write buffer", 0, 0, 0}
+};
+
+struct Result {
+	uint64_t bytesOnWire;
+	uint64_t transfers;
+	bool ok;
+};
+
+static Result measure(const SlaveConfig &config, bool large) {
+	static uint8_t memory[MEMORY_SIZE], backupBuffer[MEMORY_SIZE], stagingBuffer[MEMORY_SIZE], requestBuffer[MEMORY_SIZE];
+	static uint8_t image[IMAGE_SIZE], readBack[IMAGE_SIZE];
+
+	memset(memory, 0, sizeof(memory));
+	memset(readBack, 0, sizeof(readBack));
+	for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+		image[i] = (uint8_t)(i * 7 + 3);
+	}
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	if (config.backupSize > 0) {
+		slave.enableMemBackups(backupBuffer, config.backupSize);
+	}
+	if (config.stagingSize > 0) {
+		slave.enableStagedWrites(stagingBuffer, config.stagingSize);
+	}
+	if (config.requestSize > 0) {
+		slave.enableExtendedFrames(requestBuffer, config.requestSize);
+	}
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackMaster master;
+	bool ok = true;
+
+	if (large) {
+		CommSlaveLimits limits;
+		uint32_t failedOffset;
+
+		// Limits are read once, like application would do after connecting to slave.
+		ok = (master.readSlaveLimits(slavePtr, limits) == Ok);
+		ok = ok && (master.writeLarge(slavePtr, limits, IMAGE_ADDRESS, image, IMAGE_SIZE, &failedOffset) == Ok) && (failedOffset == IMAGE_SIZE);
+		ok = ok && (master.readLarge(slavePtr, IMAGE_ADDRESS, readBack, IMAGE_SIZE, &failedOffset) == Ok) && (failedOffset == IMAGE_SIZE);
+	} else {
+		for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += APPLICATION_CHUNK) {
+			ok = ok && (master.write(slavePtr, IMAGE_ADDRESS + offset, &image[offset], APPLICATION_CHUNK) == Ok);
+		}
+		for (uint32_t offset = 0; offset < IMAGE_SIZE; offset += APPLICATION_CHUNK) {
+			ok = ok && (master.read(slavePtr, IMAGE_ADDRESS + offset, &readBack[offset], APPLICATION_CHUNK) == Ok);
+		}
+	}
+
+	ok = ok && (memcmp(&memory[IMAGE_ADDRESS], image, IMAGE_SIZE) == 0) && (memcmp(readBack, image, IMAGE_SIZE) == 0);
+	return {master.getBytesOnWire(), master.getTransfers(), ok};
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	uint64_t bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("bus: %llu B/s, %u B image written and read back\n", (unsigned long long)bytesPerSecond, IMAGE_SIZE);
+	printf("%-26s | %28s | %28s\n", "", "application, 32 B chunks", "writeLarge/readLarge");
+	printf("%-26s | %8s %9s %9s | %8s %9s %9s\n", "slave", "bytes", "transfers", "KB/s", "bytes", "transfers", "KB/s");
+
+	for (const SlaveConfig &config : CONFIGS) {
+		Result application = measure(config, false);
+		Result large = measure(config, true);
+
+		if ( (!application.ok) || (!large.ok) ) {
+			printf("transfers to slave with %s failed\n", config.name);
+			return 1;
+		}
+
+		// Payload of both directions over time bus needs for all bytes on wire.
+		const double applicationRate = 2.0 * IMAGE_SIZE * bytesPerSecond / application.bytesOnWire / 1024;
+		const double largeRate = 2.0 * IMAGE_SIZE * bytesPerSecond / large.bytesOnWire / 1024;
+
+		printf("%-26s | %8llu %9llu %9.2f | %8llu %9llu %9.2f\n", config.name,
+			(unsigned long long)application.bytesOnWire, (unsigned long long)application.transfers, applicationRate,
+			(unsigned long long)large.bytesOnWire, (unsigned long long)large.transfers, largeRate);
+	}
+
+	return 0;
+}
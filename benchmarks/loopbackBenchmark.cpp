@@ -0,0 +1,115 @@
+/*
+loopbackBenchmark.cpp
+
+End-to-end throughput and latency of GenericMaster talking to GenericSlave through LoopbackMaster.
+Serves as reproducible baseline for protocol optimisations.
+
+Usage: loopbackBenchmark [bytesPerSecond] [transferLatencyUs]
+Without arguments bus is not simulated and only protocol processing cost is measured.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 1 << 16;
+static const uint32_t TRANSFER_SIZES[] = {1, 16, 64, 256, 1024, 4096, 16384};
+
+static uint8_t memory[MEMORY_SIZE];
+static uint8_t backupBuffer[MEMORY_SIZE];
+
+// Run given operation until time budget or number of transactions is used, print statistics.
+template <typename Operation>
+static bool runCase(const char *name, uint32_t size, Operation operation) {
+	const uint32_t maxTransactions = 20000;
+	const double budgetSeconds = 0.5;
+
+	std::vector<double> latenciesUs;
+	latenciesUs.reserve(maxTransactions);
+
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> total(0);
+
+	while ( (latenciesUs.size() < maxTransactions) && (total.count() < budgetSeconds) ) {
+		auto begin = std::chrono::steady_clock::now();
+		StatusValue status = operation();
+		auto end = std::chrono::steady_clock::now();
+
+		if (status != Ok) {
+			printf("%s of %u bytes failed with status %02xh\n", name, size, status);
+			return false;
+		}
+
+		latenciesUs.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+		total = end - start;
+	}
+
+	std::sort(latenciesUs.begin(), latenciesUs.end());
+	auto percentile = [&](double p) {
+		return latenciesUs[(size_t)(p * (latenciesUs.size() - 1))];
+	};
+
+	double transactionsPerSecond = latenciesUs.size() / total.count();
+	printf("%-6s %8u %12.0f %10.2f %9.2f %9.2f %9.2f\n", name, size, transactionsPerSecond,
+		transactionsPerSecond * size / 1e6, percentile(0.5), percentile(0.9), percentile(0.99));
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	LoopbackBus bus;
+	if (argc > 1) {
+		bus.bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+	if (argc > 2) {
+		bus.transferLatencyUs = strtoul(argv[2], nullptr, 10);
+	}
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.enableMemBackups(backupBuffer, MEMORY_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackMaster master(bus);
+
+	std::vector<uint8_t> data(MEMORY_SIZE);
+	for (auto &b : data) {
+		b = (uint8_t)rand();
+	}
+
+	printf("bus: %llu B/s, %u us per transfer\n", (unsigned long long)bus.bytesPerSecond, bus.transferLatencyUs);
+	printf("%-6s %8s %12s %10s %9s %9s %9s\n", "op", "size", "trans/s", "MB/s", "p50 us", "p90 us", "p99 us");
+
+	for (uint32_t size : TRANSFER_SIZES) {
+		bool ok = runCase("write", size, [&] {
+			return master.write(slavePtr, 0, data.data(), size);
+		});
+
+		ok = ok && runCase("read", size, [&] {
+			return master.read(slavePtr, 0, data.data(), size);
+		});
+
+		if (!ok) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
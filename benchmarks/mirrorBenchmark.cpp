@@ -0,0 +1,133 @@
+/*
+mirrorBenchmark.cpp
+
+Many threads reading the same registers of one loopback slave on simulated full-speed USB bus:
+reads/s and transfers/s of direct reads (one transaction at a time) and of MirroredSlave
+with zero TTL (concurrent misses share transfers) and with TTL.
+
+Usage: mirrorBenchmark [numberOfThreads] [transferLatencyUs]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MirroredSlave.hpp"
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 1024;
+
+// Registers every thread reads in turn: status, two sensor blocks next to each other, configuration.
+static const uint32_t REGISTERS[][2] = {{0, 4}, {64, 16}, {80, 16}, {512, 32}};
+
+struct Result {
+	double readsPerSecond;
+	double transfersPerSecond;
+	bool ok;
+};
+
+// Threads read registers for fixed time, read function returns status.
+template <typename ReadFunction>
+static Result measure(LoopbackMaster &master, uint32_t numberOfThreads, ReadFunction readRegister) {
+	const double budgetSeconds = 0.5;
+
+	std::atomic<uint64_t> reads(0);
+	std::atomic<bool> ok(true);
+	const uint64_t startTransfers = master.getTransfers();
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < numberOfThreads; t++) {
+		threads.emplace_back([&, t] {
+			uint8_t buffer[MEMORY_SIZE];
+
+			for (uint32_t i = t; std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < budgetSeconds; i++) {
+				const uint32_t *reg = REGISTERS[i % (sizeof(REGISTERS) / sizeof(REGISTERS[0]))];
+				if (readRegister(reg[0], buffer, reg[1]) != Ok) {
+					ok = false;
+				}
+				reads++;
+			}
+		});
+	}
+
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return {reads / elapsed.count(), (master.getTransfers() - startTransfers) / elapsed.count(), ok};
+}
+
+int main(int argc, char **argv) {
+	uint32_t numberOfThreads = 8;
+	uint32_t transferLatencyUs = 125;
+
+	if (argc > 1) {
+		numberOfThreads = strtoul(argv[1], nullptr, 10);
+	}
+	if (argc > 2) {
+		transferLatencyUs = strtoul(argv[2], nullptr, 10);
+	}
+
+	static uint8_t memory[MEMORY_SIZE];
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	// Full-speed USB, 64 byte packets.
+	LoopbackBus bus;
+	bus.bytesPerSecond = 1216000;
+	bus.transferLatencyUs = transferLatencyUs;
+	bus.maxTransferSize = 64;
+	LoopbackMaster master(bus);
+
+	printf("threads: %u, transfer latency: %u us\n", numberOfThreads, transferLatencyUs);
+	printf("%-22s | %10s | %11s\n", "", "reads/s", "transfers/s");
+
+	// Master allows one transaction per slave at a time.
+	std::mutex busMutex;
+	Result direct = measure(master, numberOfThreads, [&](uint32_t address, uint8_t *buffer, uint32_t length) {
+		std::lock_guard<std::mutex> lock(busMutex);
+		return master.read(slavePtr, address, buffer, length);
+	});
+
+	MirroredSlave<GenericSlave*> coalescing(master, slavePtr, 0, MEMORY_SIZE);
+	Result shared = measure(master, numberOfThreads, [&](uint32_t address, uint8_t *buffer, uint32_t length) {
+		return coalescing.read(address, buffer, length);
+	});
+
+	MirroredSlave<GenericSlave*> cached(master, slavePtr, 0, MEMORY_SIZE);
+	cached.setTtl(0, MEMORY_SIZE, std::chrono::milliseconds(10));
+	Result ttl = measure(master, numberOfThreads, [&](uint32_t address, uint8_t *buffer, uint32_t length) {
+		return cached.read(address, buffer, length);
+	});
+
+	if ( (!direct.ok) || (!shared.ok) || (!ttl.ok) ) {
+		printf("reads failed\n");
+		return 1;
+	}
+
+	printf("%-22s | %10.0f | %11.0f\n", "direct", direct.readsPerSecond, direct.transfersPerSecond);
+	printf("%-22s | %10.0f | %11.0f\n", "mirror, zero TTL", shared.readsPerSecond, shared.transfersPerSecond);
+	printf("%-22s | %10.0f | %11.0f\n", "mirror, 10 ms TTL", ttl.readsPerSecond, ttl.transfersPerSecond);
+
+	return 0;
+}
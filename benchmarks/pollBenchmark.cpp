@@ -0,0 +1,165 @@
+/*
+pollBenchmark.cpp
+
+Measures poll rate of PollGroup reading regions of many loopback slaves, each on its own simulated
+full-speed USB bus, with different number of workers, with and without batch frames.
+
+Usage: pollBenchmark [numberOfSlaves] [regionsPerSlave] [transferLatencyUs]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "PollGroup.hpp"
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 4096;
+static const uint32_t REGION_SIZE = 32;
+static const uint32_t REGION_STRIDE = 256;
+static const uint32_t REQUEST_BUFFER_SIZE = 1024;
+
+struct Slave {
+	GenericSlave slave;
+	uint8_t memory[MEMORY_SIZE];
+	uint8_t requestBuffer[REQUEST_BUFFER_SIZE];
+};
+
+struct Result {
+	double cyclesPerSecond;
+	uint64_t failedEntries;
+};
+
+// Run cycles back to back for fixed time.
+static Result measure(PollGroup<GenericSlave*> &group) {
+	const double budgetSeconds = 0.5;
+
+	Result result = {0, 0};
+	uint64_t cycles = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> total(0);
+
+	while (total.count() < budgetSeconds) {
+		PollCycle cycle = group.runCycle();
+		result.failedEntries += cycle.failedEntries;
+
+		cycles++;
+		total = std::chrono::steady_clock::now() - start;
+	}
+
+	result.cyclesPerSecond = cycles / total.count();
+
+	return result;
+}
+
+int main(int argc, char **argv) {
+	uint32_t numberOfSlaves = 8;
+	uint32_t regionsPerSlave = 4;
+
+	LoopbackBus bus;
+	bus.bytesPerSecond = 1216000;
+	bus.transferLatencyUs = 125;
+
+	if (argc > 1) {
+		numberOfSlaves = strtoul(argv[1], nullptr, 10);
+	}
+	if (argc > 2) {
+		regionsPerSlave = strtoul(argv[2], nullptr, 10);
+	}
+	if (argc > 3) {
+		bus.transferLatencyUs = strtoul(argv[3], nullptr, 10);
+	}
+
+	if ( (numberOfSlaves == 0) || (regionsPerSlave == 0) || (regionsPerSlave * REGION_STRIDE > MEMORY_SIZE) ) {
+		printf("invalid arguments\n");
+		return 1;
+	}
+
+	std::vector<std::unique_ptr<Slave>> slaves;
+	for (uint32_t i = 0; i < numberOfSlaves; i++) {
+		slaves.emplace_back(new Slave());
+		slaves[i]->slave.initialize(slaves[i]->memory, MEMORY_SIZE);
+		slaves[i]->slave.enableExtendedFrames(slaves[i]->requestBuffer, REQUEST_BUFFER_SIZE);
+	}
+
+	std::vector<uint8_t> buffers(numberOfSlaves * regionsPerSlave * REGION_SIZE);
+	LoopbackMaster master(bus);
+
+	printf("%u slaves x %u regions of %u B, bus: %llu B/s, %u us per transfer\n", numberOfSlaves, regionsPerSlave,
+		REGION_SIZE, (unsigned long long)bus.bytesPerSecond, bus.transferLatencyUs);
+	printf("%-8s %-8s | %10s %10s %10s | %8s\n", "workers", "batching", "cycles/s", "reads/s", "xfer/cyc", "speedup");
+
+	double baseline = 0;
+
+	for (bool batching : {false, true}) {
+		for (uint32_t workers = 1; workers <= numberOfSlaves; workers *= 2) {
+			PollGroup<GenericSlave*> group(master, workers);
+			group.setBatching(batching);
+
+			for (uint32_t i = 0; i < numberOfSlaves; i++) {
+				for (uint32_t j = 0; j < regionsPerSlave; j++) {
+					uint8_t *buffer = &buffers[(i * regionsPerSlave + j) * REGION_SIZE];
+					group.add(&slaves[i]->slave, j * REGION_STRIDE, buffer, REGION_SIZE);
+				}
+			}
+
+			uint64_t transfersBefore = master.getTransfers();
+			group.runCycle();
+			double transfersPerCycle = master.getTransfers() - transfersBefore;
+
+			Result result = measure(group);
+			if (result.failedEntries > 0) {
+				printf("%llu reads failed\n", (unsigned long long)result.failedEntries);
+				return 1;
+			}
+
+			if (baseline == 0) {
+				baseline = result.cyclesPerSecond;
+			}
+
+			printf("%-8u %-8s | %10.0f %10.0f %10.0f | %7.1fx\n", workers, batching ? "yes" : "no", result.cyclesPerSecond,
+				result.cyclesPerSecond * numberOfSlaves * regionsPerSlave, transfersPerCycle, result.cyclesPerSecond / baseline);
+		}
+	}
+
+	// Periodic polling at rate which single worker cannot keep up with.
+	const std::chrono::microseconds period((uint64_t)(1e6 / baseline / 2));
+	printf("\nperiodic polling every %lld us for 1 s\n", (long long)period.count());
+	printf("%-8s | %8s %10s %8s\n", "workers", "cycles", "deadline", "skipped");
+
+	for (uint32_t workers = 1; workers <= numberOfSlaves; workers *= 2) {
+		PollGroup<GenericSlave*> group(master, workers);
+
+		for (uint32_t i = 0; i < numberOfSlaves; i++) {
+			for (uint32_t j = 0; j < regionsPerSlave; j++) {
+				uint8_t *buffer = &buffers[(i * regionsPerSlave + j) * REGION_SIZE];
+				group.add(&slaves[i]->slave, j * REGION_STRIDE, buffer, REGION_SIZE);
+			}
+		}
+
+		group.start(period);
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		group.stop();
+
+		PollStatistics statistics = group.getStatistics();
+		printf("%-8u | %8llu %10llu %8llu\n", workers, (unsigned long long)statistics.cycles,
+			(unsigned long long)statistics.deadlineMisses, (unsigned long long)statistics.skippedCycles);
+	}
+
+	return 0;
+}
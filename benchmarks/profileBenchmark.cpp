@@ -0,0 +1,109 @@
+/*
+profileBenchmark.cpp
+
+Compares protocol profiles (widths of frame header fields) on small register accesses:
+bytes on wire per transaction and transactions/s over simulated I2C bus.
+
+Usage: profileBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 256;
+static const uint32_t ACCESS_SIZES[] = {1, 4, 16, 60};
+
+struct Result {
+	double bytesPerTransaction;
+	double transactionsPerSecond;
+};
+
+// Repeat read or write of given size for fixed time.
+template <typename Profile>
+static bool measure(LoopbackBus bus, bool read, uint32_t size, Result &result) {
+	const double budgetSeconds = 0.2;
+
+	static uint8_t memory[MEMORY_SIZE];
+	uint8_t buffer[MEMORY_SIZE] = {};
+
+	BasicGenericSlave<Profile> slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	BasicGenericSlave<Profile> *slavePtr = &slave;
+
+	BasicLoopbackMaster<Profile> master(bus);
+
+	uint64_t transactions = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> total(0);
+
+	while (total.count() < budgetSeconds) {
+		StatusValue status = read ? master.read(slavePtr, 16, buffer, size) : master.write(slavePtr, 16, buffer, size);
+		if (status != Ok) {
+			return false;
+		}
+
+		transactions++;
+		total = std::chrono::steady_clock::now() - start;
+	}
+
+	result.bytesPerTransaction = (double)master.getBytesOnWire() / transactions;
+	result.transactionsPerSecond = transactions / total.count();
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	LoopbackBus bus;
+	bus.bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bus.bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("bus: %llu B/s, CRC8\n", (unsigned long long)bus.bytesPerSecond);
+	printf("%-6s %5s | %16s | %16s | %16s | %7s\n", "op", "size", "default (4+4)", "compact (2+2)", "tiny (1+1)", "speedup");
+	printf("%-6s %5s | %7s %8s | %7s %8s | %7s %8s | %7s\n", "", "", "B/tr", "trans/s", "B/tr", "trans/s", "B/tr", "trans/s", "tiny");
+
+	for (const char *op : {"read", "write"}) {
+		const bool read = (op[0] == 'r');
+
+		for (uint32_t size : ACCESS_SIZES) {
+			Result results[3];
+
+			bool ok = measure<DefaultProfile>(bus, read, size, results[0]) &&
+				measure<CompactProfile>(bus, read, size, results[1]) &&
+				measure<TinyProfile>(bus, read, size, results[2]);
+
+			if (!ok) {
+				printf("%s of %u bytes failed\n", op, size);
+				return 1;
+			}
+
+			printf("%-6s %5u | %7.1f %8.0f | %7.1f %8.0f | %7.1f %8.0f | %6.2fx\n", op, size,
+				results[0].bytesPerTransaction, results[0].transactionsPerSecond,
+				results[1].bytesPerTransaction, results[1].transactionsPerSecond,
+				results[2].bytesPerTransaction, results[2].transactionsPerSecond,
+				results[2].transactionsPerSecond / results[0].transactionsPerSecond);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+/*
+retryBenchmark.cpp
+
+Master reads and writes registers of slave over noisy link: share of transactions failed, frames sent
+and latency until data is transferred, when application repeats failed transactions at its next poll
+(every 10 ms) and when retry policy repeats them at once. Runs in simulated time over 400 kHz I2C,
+every byte on wire is corrupted with given probability.
+
+Usage: retryBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 256;
+static const uint32_t BACKUP_SIZE = 64;
+static const uint32_t TRANSACTIONS = 2000;
+static const uint32_t TRANSFER_SIZE = 16;
+static const uint32_t POLL_INTERVAL_US = 10000;
+static const double BYTE_ERROR_RATES[] = {0.001, 0.01, 0.03};
+
+// Master living in simulated time over link corrupting bytes in both directions.
+class NoisyMaster : public LoopbackMaster {
+public:
+	NoisyMaster(uint64_t bytesPerSecond, double byteErrorRate):
+		bytesPerSecond(bytesPerSecond),
+		byteErrorRate(byteErrorRate),
+		now(0),
+		frames(0),
+		random(0x2545F491)
+	{}
+
+	uint64_t bytesPerSecond;
+	double byteErrorRate;
+	uint64_t now;
+	uint64_t frames;
+
+	uint64_t getTimeUs() override {
+		return now;
+	}
+
+	void sleepUs(uint32_t delayUs) override {
+		now += delayUs;
+	}
+
+protected:
+	int writeBytesV(Slave* &slave, const CommSegment *segments, uint32_t numberOfSegments) override {
+		frames++;
+
+		std::vector<uint8_t> bytes;
+		for (uint32_t i = 0; i < numberOfSegments; i++) {
+			bytes.insert(bytes.end(), segments[i].data, segments[i].data + segments[i].size);
+		}
+
+		// Header is left intact, corrupted one would desynchronise loopback slave for good.
+		for (uint32_t i = Profile::HEADER_SIZE; i < bytes.size(); i++) {
+			corrupt(bytes[i]);
+		}
+
+		advance(bytes.size());
+		return LoopbackMaster::writeBytes(slave, bytes.data(), bytes.size());
+	}
+
+	int writeBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override {
+		frames++;
+		advance(numberOfBytes);
+		return LoopbackMaster::writeBytes(slave, byteArray, numberOfBytes);
+	}
+
+	int readBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override {
+		int ret = LoopbackMaster::readBytes(slave, byteArray, numberOfBytes);
+
+		for (uint32_t i = 0; i < numberOfBytes; i++) {
+			corrupt(byteArray[i]);
+		}
+
+		advance(numberOfBytes);
+		return ret;
+	}
+
+private:
+	using Profile = DefaultProfile;
+
+	uint32_t random;
+
+	void advance(uint32_t numberOfBytes) {
+		now += numberOfBytes * 1000000ull / bytesPerSecond;
+	}
+
+	void corrupt(uint8_t &byte) {
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+
+		if (random < byteErrorRate * UINT32_MAX) {
+			byte ^= (uint8_t)(1 << (random & 7));
+		}
+	}
+};
+
+struct Result {
+	double failedPercent; // Transactions which did not succeed at first call.
+	double framesPerTransaction;
+	double latencyUs; // From the first attempt until data is transferred.
+};
+
+static bool measure(uint64_t bytesPerSecond, double byteErrorRate, bool write, bool policy, Result &result) {
+	static uint8_t memory[MEMORY_SIZE];
+	static uint8_t backupBuffer[BACKUP_SIZE];
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.enableMemBackups(backupBuffer, BACKUP_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	NoisyMaster master(bytesPerSecond, byteErrorRate);
+
+	if (policy) {
+		CommRetryPolicy retryPolicy;
+		retryPolicy.maxAttempts = 8;
+		master.setRetryPolicy(retryPolicy);
+	}
+
+	uint64_t failed = 0;
+	uint64_t latency = 0;
+	uint8_t buffer[TRANSFER_SIZE] = {};
+
+	for (uint32_t i = 0; i < TRANSACTIONS; i++) {
+		const uint64_t start = master.now;
+		uint32_t calls = 0;
+		StatusValue status;
+
+		do {
+			// Application repeats transaction at its next poll.
+			if (calls++ > 0) {
+				master.sleepUs(POLL_INTERVAL_US);
+			}
+
+			buffer[0] = (uint8_t)i;
+			status = write ? master.write(slavePtr, 0, buffer, TRANSFER_SIZE) : master.read(slavePtr, 0, buffer, TRANSFER_SIZE);
+		} while ( (status != Ok) && (calls < 100) );
+
+		if (status != Ok) {
+			return false;
+		}
+
+		failed += (calls > 1);
+		latency += master.now - start;
+	}
+
+	result.failedPercent = 100.0 * failed / TRANSACTIONS;
+	result.framesPerTransaction = (double)master.frames / TRANSACTIONS;
+	result.latencyUs = (double)latency / TRANSACTIONS;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	uint64_t bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("bus: %llu B/s, %u transactions of %u B per row, application polls every %u us\n",
+		(unsigned long long)bytesPerSecond, TRANSACTIONS, TRANSFER_SIZE, POLL_INTERVAL_US);
+	printf("%6s %8s | %27s | %27s\n", "", "byte", "retried by application", "retry policy (8 attempts)");
+	printf("%6s %8s | %7s %7s %11s | %7s %7s %11s\n", "op", "errors", "failed%", "frames", "latency us", "failed%", "frames", "latency us");
+
+	for (int write = 0; write < 2; write++) {
+		for (double rate : BYTE_ERROR_RATES) {
+			Result application, policy;
+
+			if ( !measure(bytesPerSecond, rate, write, false, application) || !measure(bytesPerSecond, rate, write, true, policy) ) {
+				printf("transactions at byte error rate %g failed\n", rate);
+				return 1;
+			}
+
+			printf("%6s %7.1f%% | %7.2f %7.2f %11.0f | %7.2f %7.2f %11.0f\n", write ? "write" : "read", rate * 100,
+				application.failedPercent, application.framesPerTransaction, application.latencyUs,
+				policy.failedPercent, policy.framesPerTransaction, policy.latencyUs);
+		}
+	}
+
+	return 0;
+}
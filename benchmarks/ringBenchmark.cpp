@@ -0,0 +1,151 @@
+/*
+ringBenchmark.cpp
+
+Verifies CommRing with producer thread standing in for interrupt handler and compares
+per-byte work done in interrupt handler by picoSlaveI2C in normal mode (GenericSlave::writeHandler)
+and in deferred mode (CommRing::push).
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "CommRing.hpp"
+#include "GenericSlave.hpp"
+
+static const uint32_t RING_SIZE = 256;
+static const uint64_t STREAM_SIZE = 1ull << 26;
+static const uint32_t MEMORY_SIZE = 1024;
+static const uint32_t FRAME_PAYLOAD = 256;
+
+static inline uint8_t sequenceByte(uint64_t i) {
+	return (uint8_t)(i ^ (i >> 8));
+}
+
+// Producer thread pushes bytes one by one (as interrupt handler does), consumer pops in blocks and checks order.
+static bool streamTest(double &megabytesPerSecond) {
+	std::vector<uint8_t> storage(RING_SIZE);
+	CommRing ring;
+	if (!ring.initialize(storage.data(), RING_SIZE)) {
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&] {
+		for (uint64_t i = 0; i < STREAM_SIZE; ) {
+			if (ring.push(sequenceByte(i))) {
+				i++;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	bool ok = true;
+	uint8_t chunk[64];
+	for (uint64_t i = 0; i < STREAM_SIZE; ) {
+		uint32_t n = ring.pop(chunk, sizeof(chunk));
+		if (n == 0) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		for (uint32_t j = 0; j < n; j++) {
+			ok = ok && (chunk[j] == sequenceByte(i + j));
+		}
+		i += n;
+	}
+
+	producer.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	megabytesPerSecond = STREAM_SIZE / elapsed.count() / 1e6;
+
+	return ok && (ring.available() == 0);
+}
+
+// Nanoseconds per byte spent receiving write frames, frameDone is called after every frame.
+template <typename Handler, typename FrameDone>
+static double handlerCost(const std::vector<uint8_t> &frame, Handler handler, FrameDone frameDone) {
+	const uint32_t repetitions = 20000;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t r = 0; r < repetitions; r++) {
+		for (uint8_t byte : frame) {
+			handler(byte);
+		}
+		frameDone();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / repetitions / frame.size();
+}
+
+int main() {
+	double megabytesPerSecond;
+	if (!streamTest(megabytesPerSecond)) {
+		printf("ring stream test failed\n");
+		return 1;
+	}
+	printf("ring stream: %llu bytes in order, %.1f MB/s\n", (unsigned long long)STREAM_SIZE, megabytesPerSecond);
+
+	// Write frame with CRC8 checksum, followed by status request.
+	std::vector<uint8_t> frame(SLAVE_ADDRESS_SIZE * 2 + FRAME_PAYLOAD);
+	uint32_t lengthField = FRAME_PAYLOAD;
+	uint32_t address = 0;
+	memcpy(&frame[0], &lengthField, SLAVE_ADDRESS_SIZE);
+	memcpy(&frame[SLAVE_ADDRESS_SIZE], &address, SLAVE_ADDRESS_SIZE);
+	for (uint32_t i = 0; i < FRAME_PAYLOAD; i++) {
+		frame[SLAVE_ADDRESS_SIZE * 2 + i] = sequenceByte(i);
+	}
+	frame.push_back(calculateChecksum(frame.data(), frame.size()));
+
+	std::vector<uint8_t> memory(MEMORY_SIZE), backup(MEMORY_SIZE);
+	GenericSlave slave;
+	slave.initialize(memory.data(), MEMORY_SIZE);
+	slave.enableMemBackups(backup.data(), MEMORY_SIZE);
+
+	// Normal mode: whole state machine runs in interrupt handler, including status byte.
+	double normal = handlerCost(frame, [&](uint8_t byte) {
+		slave.writeHandler(byte);
+	}, [&] {
+		slave.readHandler();
+	});
+
+	if (memcmp(memory.data(), &frame[SLAVE_ADDRESS_SIZE * 2], FRAME_PAYLOAD) != 0) {
+		printf("write frames were not applied\n");
+		return 1;
+	}
+
+	// Deferred mode: interrupt handler only pushes bytes, ring is drained after every frame.
+	std::vector<uint8_t> storage(RING_SIZE * 2);
+	CommRing ring;
+	ring.initialize(storage.data(), storage.size());
+	uint8_t sink[RING_SIZE * 2];
+
+	double deferred = handlerCost(frame, [&](uint8_t byte) {
+		ring.push(byte);
+	}, [&] {
+		ring.pop(sink, sizeof(sink));
+	});
+
+	printf("receive work per byte in interrupt handler: normal %.2f ns, deferred %.2f ns (including ring drain), %.1fx less\n",
+		normal, deferred, normal / deferred);
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+statsBenchmark.cpp
+
+Cost of transport statistics: transactions/s of small reads and writes through LoopbackMaster.
+Built three times, as statsBenchmark (EMBEDDEDCOMM_STATS=1), statsBenchmarkTiming (EMBEDDEDCOMM_STATS=1,
+EMBEDDEDCOMM_STATS_TIMING=1) and statsBenchmarkOff (EMBEDDEDCOMM_STATS=0), compare their output to see
+the overhead. With statistics enabled collected counters and slave's counters read through its statistics
+window are printed as well, with timing also latency percentiles.
+
+Usage: statsBenchmark [transactions]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 256;
+static const uint32_t STATISTICS_WINDOW = 0x10000;
+static const uint32_t TRANSFER_SIZES[] = {1, 4, 16, 64};
+
+static uint8_t memory[MEMORY_SIZE];
+
+static void callback() {}
+
+int main(int argc, char **argv) {
+	uint32_t transactions = 200000;
+
+	if (argc > 1) {
+		transactions = strtoul(argv[1], nullptr, 10);
+	}
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.addMemoryChangeCallback(0, callback);
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackMaster master;
+
+#if EMBEDDEDCOMM_STATS
+	slave.enableStatisticsWindow(STATISTICS_WINDOW);
+	printf("statistics enabled%s, %u transactions per row\n", EMBEDDEDCOMM_STATS_TIMING ? " with timing" : "", transactions);
+#else
+	printf("statistics disabled, %u transactions per row\n", transactions);
+#endif
+	printf("%6s %8s %12s %10s\n", "op", "size", "trans/s", "ns/trans");
+
+	for (uint32_t size : TRANSFER_SIZES) {
+		uint8_t buffer[64] = {};
+
+		for (int write = 0; write < 2; write++) {
+			auto start = std::chrono::steady_clock::now();
+
+			for (uint32_t i = 0; i < transactions; i++) {
+				buffer[0] = (uint8_t)i;
+				StatusValue status = write ? master.write(slavePtr, 0, buffer, size) : master.read(slavePtr, 0, buffer, size);
+
+				if (status != Ok) {
+					printf("%s of %u bytes failed with status %02xh\n", write ? "write" : "read", size, status);
+					return 1;
+				}
+			}
+
+			std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+			printf("%6s %8u %12.0f %10.1f\n", write ? "write" : "read", size, transactions / total.count(),
+				total.count() * 1e9 / transactions);
+		}
+	}
+
+#if EMBEDDEDCOMM_STATS
+	const CommMasterStatistics &statistics = master.getStatistics(slavePtr);
+	printf("\nmaster: %llu frames, %llu B out, %llu B in, %llu checksum errors, %llu transport errors, %llu busy\n",
+		(unsigned long long)statistics.frames, (unsigned long long)statistics.bytesOut,
+		(unsigned long long)statistics.bytesIn, (unsigned long long)statistics.checksumErrors,
+		(unsigned long long)statistics.transportErrors, (unsigned long long)statistics.statusCounts[5]);
+#if EMBEDDEDCOMM_STATS_TIMING
+	printf("latency us: p50 %u, p90 %u, p99 %u, p99.9 %u, max %u\n",
+		statistics.latency.percentile(0.5), statistics.latency.percentile(0.9), statistics.latency.percentile(0.99),
+		statistics.latency.percentile(0.999), statistics.latency.max);
+#endif
+
+	CommSlaveStatistics slaveStatistics;
+	StatusValue status = master.readSlaveStatistics(slavePtr, STATISTICS_WINDOW, slaveStatistics);
+	if (status != Ok) {
+		printf("reading slave statistics failed with status %02xh\n", status);
+		return 1;
+	}
+
+	printf("slave: %u frames, %u B received, %u B sent, %u callbacks taking %u us (max %u us), busy for %u us\n",
+		slaveStatistics.frames, slaveStatistics.bytesReceived, slaveStatistics.bytesSent,
+		slaveStatistics.callbacksExecuted, slaveStatistics.callbackTimeUs, slaveStatistics.maxCallbackTimeUs,
+		slaveStatistics.busyTimeUs);
+#endif
+
+	return 0;
+}
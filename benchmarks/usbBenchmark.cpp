@@ -0,0 +1,127 @@
+/*
+usbBenchmark.cpp
+
+Compares USB transfer strategies over loopback transport with full-speed USB bus model.
+Old host read responses packet by packet (one 64 byte transfer each), current one requests
+all full packets in one transfer and the last packet separately.
+
+Usage: usbBenchmark [transferLatencyUs] [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 1 << 16;
+static const uint32_t USB_PACKET_SIZE = 64;
+static const uint32_t TRANSFER_SIZES[] = {16, 64, 256, 1024, 4096, 16384};
+
+static uint8_t memory[MEMORY_SIZE];
+
+struct Result {
+	double transactionsPerSecond;
+	double transfersPerTransaction;
+};
+
+// Repeat operation for fixed time, measure transaction rate and number of USB transfers per transaction.
+template <typename Operation>
+static bool measure(LoopbackMaster &master, Operation operation, Result &result) {
+	const double budgetSeconds = 0.3;
+
+	uint64_t transactions = 0;
+	uint64_t transfersBefore = master.getTransfers();
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> total(0);
+
+	while (total.count() < budgetSeconds) {
+		if (operation() != Ok) {
+			return false;
+		}
+
+		transactions++;
+		total = std::chrono::steady_clock::now() - start;
+	}
+
+	result.transactionsPerSecond = transactions / total.count();
+	result.transfersPerTransaction = (double)(master.getTransfers() - transfersBefore) / transactions;
+
+	return true;
+}
+
+int main(int argc, char **argv) {
+	// Full-speed bulk: at most 19 packets of 64 bytes per 1 ms frame.
+	LoopbackBus bus;
+	bus.bytesPerSecond = 1216000;
+	bus.transferLatencyUs = 125;
+
+	if (argc > 1) {
+		bus.transferLatencyUs = strtoul(argv[1], nullptr, 10);
+	}
+	if (argc > 2) {
+		bus.bytesPerSecond = strtoull(argv[2], nullptr, 10);
+	}
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	std::vector<uint8_t> buffer(MEMORY_SIZE);
+
+	LoopbackBus packetBus = bus;
+	packetBus.maxTransferSize = USB_PACKET_SIZE;
+
+	LoopbackMaster packetMaster(packetBus);
+	LoopbackMaster streamMaster(bus);
+
+	printf("bus: %llu B/s, %u us per transfer\n", (unsigned long long)bus.bytesPerSecond, bus.transferLatencyUs);
+	printf("%-6s %8s | %14s %10s %9s | %14s %10s %9s | %7s\n", "op", "size",
+		"packet xfer/tr", "trans/s", "MB/s", "stream xfer/tr", "trans/s", "MB/s", "speedup");
+
+	for (const char *op : {"read", "write"}) {
+		const bool read = (op[0] == 'r');
+
+		for (uint32_t size : TRANSFER_SIZES) {
+			Result results[2];
+			LoopbackMaster *masters[2] = {&packetMaster, &streamMaster};
+
+			for (int i = 0; i < 2; i++) {
+				LoopbackMaster &master = *masters[i];
+
+				bool ok = measure(master, [&] {
+					if (read) {
+						return master.read(slavePtr, 0, buffer.data(), size);
+					}
+					return master.write(slavePtr, 0, buffer.data(), size);
+				}, results[i]);
+
+				if (!ok) {
+					printf("%s of %u bytes failed\n", op, size);
+					return 1;
+				}
+			}
+
+			printf("%-6s %8u | %14.1f %10.0f %9.3f | %14.1f %10.0f %9.3f | %6.1fx\n", op, size,
+				results[0].transfersPerTransaction, results[0].transactionsPerSecond, results[0].transactionsPerSecond * size / 1e6,
+				results[1].transfersPerTransaction, results[1].transactionsPerSecond, results[1].transactionsPerSecond * size / 1e6,
+				results[1].transactionsPerSecond / results[0].transactionsPerSecond);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*
+waitBenchmark.cpp
+
+Master writes register and waits until slave's callback handled it: status frames, bytes on wire
+and latency (from slave becoming ready to master noticing it) of polling readStatus() implemented
+as 1 byte read every 500 us and of waitReady(). Runs in simulated time over 400 kHz I2C.
+
+Usage: waitBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 64;
+static const uint32_t WAITS = 200;
+static const uint32_t LEGACY_POLL_US = 500;
+static const uint32_t CALLBACK_DURATIONS_US[] = {50, 300, 1000, 4000};
+
+static void callback() {}
+
+// Master living in simulated time: bus transfers and delays advance the clock, slave's main loop
+// finishes callbacks once the clock reaches readyAt.
+class SimulatedMaster : public LoopbackMaster {
+public:
+	SimulatedMaster(uint64_t bytesPerSecond): bytesPerSecond(bytesPerSecond), now(0), readyAt(0), frames(0) {
+		setAutoProcess(false);
+	}
+
+	uint64_t bytesPerSecond;
+	uint64_t now;
+	uint64_t readyAt;
+	uint64_t frames;
+
+	uint64_t getTimeUs() override {
+		return now;
+	}
+
+	void sleepUs(uint32_t delayUs) override {
+		now += delayUs;
+	}
+
+	// Slave's main loop runs between transfers.
+	void runSlave(Slave *slave) {
+		if (now >= readyAt) {
+			slave->process();
+		}
+	}
+
+protected:
+	int writeBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override {
+		runSlave(slave);
+		frames++;
+		now += numberOfBytes * 1000000ull / bytesPerSecond;
+		return LoopbackMaster::writeBytes(slave, byteArray, numberOfBytes);
+	}
+
+	int writeBytesV(Slave* &slave, const CommSegment *segments, uint32_t numberOfSegments) override {
+		runSlave(slave);
+		frames++;
+		for (uint32_t i = 0; i < numberOfSegments; i++) {
+			now += segments[i].size * 1000000ull / bytesPerSecond;
+		}
+		return LoopbackMaster::writeBytesV(slave, segments, numberOfSegments);
+	}
+
+	int readBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override {
+		now += numberOfBytes * 1000000ull / bytesPerSecond;
+		return LoopbackMaster::readBytes(slave, byteArray, numberOfBytes);
+	}
+};
+
+struct Result {
+	double framesPerWait;
+	double bytesPerWait;
+	double latencyUs;
+};
+
+static bool measure(uint64_t bytesPerSecond, uint32_t durationUs, bool adaptive, Result &result) {
+	static uint8_t memory[MEMORY_SIZE];
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	slave.addMemoryChangeCallback(8, callback);
+	GenericSlave *slavePtr = &slave;
+
+	SimulatedMaster master(bytesPerSecond);
+	uint64_t frames = 0;
+	uint64_t bytes = 0;
+	uint64_t latency = 0;
+
+	for (uint32_t i = 0; i < WAITS; i++) {
+		uint8_t value = (uint8_t)i;
+		if (master.write(slavePtr, 8, &value, 1) != Ok) {
+			return false;
+		}
+		master.readyAt = master.now + durationUs;
+
+		const uint64_t framesBefore = master.frames;
+		const uint64_t bytesBefore = master.getBytesOnWire();
+
+		if (adaptive) {
+			if (master.waitReady(slavePtr, 1000000) != Ok) {
+				return false;
+			}
+		} else {
+			uint8_t dummy;
+			while (master.read(slavePtr, 0, &dummy, 1) & Busy) {
+				master.sleepUs(LEGACY_POLL_US);
+			}
+		}
+
+		frames += master.frames - framesBefore;
+		bytes += master.getBytesOnWire() - bytesBefore;
+		latency += master.now - master.readyAt;
+
+		// Slave's main loop catches up before next write.
+		master.now += LEGACY_POLL_US;
+		master.runSlave(slavePtr);
+	}
+
+	result.framesPerWait = (double)frames / WAITS;
+	result.bytesPerWait = (double)bytes / WAITS;
+	result.latencyUs = (double)latency / WAITS;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	uint64_t bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("bus: %llu B/s, %u waits per row\n", (unsigned long long)bytesPerSecond, WAITS);
+	printf("%10s | %26s | %26s\n", "callback", "readStatus + 500 us sleep", "waitReady");
+	printf("%10s | %7s %7s %10s | %7s %7s %10s\n", "us", "frames", "B", "latency us", "frames", "B", "latency us");
+
+	for (uint32_t duration : CALLBACK_DURATIONS_US) {
+		Result legacy, adaptive;
+
+		if ( !measure(bytesPerSecond, duration, false, legacy) || !measure(bytesPerSecond, duration, true, adaptive) ) {
+			printf("wait for %u us callback failed\n", duration);
+			return 1;
+		}
+
+		printf("%10u | %7.1f %7.1f %10.0f | %7.1f %7.1f %10.0f\n", duration,
+			legacy.framesPerWait, legacy.bytesPerWait, legacy.latencyUs,
+			adaptive.framesPerWait, adaptive.bytesPerWait, adaptive.latencyUs);
+	}
+
+	return 0;
+}
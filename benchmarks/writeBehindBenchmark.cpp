@@ -0,0 +1,113 @@
+/*
+writeBehindBenchmark.cpp
+
+Control loop writing many small neighbouring registers every cycle: frames, bytes on wire and
+cycles/s over simulated 400 kHz I2C of direct writes and of writes through WriteBehindBuffer.
+
+Usage: writeBehindBenchmark [bytesPerSecond]
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+
+#include "WriteBehindBuffer.hpp"
+#include "loopback/LoopbackMaster.hpp"
+
+static const uint32_t MEMORY_SIZE = 1024;
+static const uint32_t CYCLES = 50;
+
+// Register writes of one control cycle: address and size. Outputs are written one by one,
+// some of them twice (limit applied after setpoint).
+static const uint32_t CYCLE_WRITES[][2] = {
+	{0x40, 2}, {0x42, 2}, {0x44, 2}, {0x46, 2}, {0x48, 4}, {0x4C, 4}, {0x50, 1}, {0x51, 1},
+	{0x52, 2}, {0x40, 2}, {0x54, 4}, {0x58, 4}, {0x5C, 2}, {0x5E, 2}, {0x80, 4}, {0x84, 1}
+};
+
+struct Result {
+	double framesPerCycle;
+	double bytesPerCycle;
+	double cyclesPerSecond;
+	bool ok;
+};
+
+static Result measure(uint64_t bytesPerSecond, bool writeBehind) {
+	static uint8_t memory[MEMORY_SIZE], expected[MEMORY_SIZE];
+	memset(memory, 0, sizeof(memory));
+	memset(expected, 0, sizeof(expected));
+
+	GenericSlave slave;
+	slave.initialize(memory, MEMORY_SIZE);
+	GenericSlave *slavePtr = &slave;
+
+	LoopbackBus bus;
+	bus.bytesPerSecond = bytesPerSecond;
+	LoopbackMaster master(bus);
+	WriteBehindBuffer<GenericSlave*> buffer(master, slavePtr);
+
+	bool ok = true;
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t cycle = 0; cycle < CYCLES; cycle++) {
+		for (const uint32_t *write : CYCLE_WRITES) {
+			uint8_t value[4];
+			for (uint32_t i = 0; i < write[1]; i++) {
+				value[i] = (uint8_t)(cycle + write[0] + i);
+			}
+			memcpy(&expected[write[0]], value, write[1]);
+
+			StatusValue status = writeBehind ? buffer.write(write[0], value, write[1]) : master.write(slavePtr, write[0], value, write[1]);
+			ok = ok && (status == Ok);
+		}
+
+		// End of control cycle.
+		if (writeBehind) {
+			ok = ok && (buffer.flush() == Ok);
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	ok = ok && (memcmp(memory, expected, MEMORY_SIZE) == 0);
+
+	const double frames = writeBehind ? buffer.getStatistics().frames : CYCLES * (sizeof(CYCLE_WRITES) / sizeof(CYCLE_WRITES[0]));
+	return {frames / CYCLES, (double)master.getBytesOnWire() / CYCLES, CYCLES / elapsed.count(), ok};
+}
+
+int main(int argc, char **argv) {
+	// 400 kHz I2C, 9 clocks per byte.
+	uint64_t bytesPerSecond = 44444;
+
+	if (argc > 1) {
+		bytesPerSecond = strtoull(argv[1], nullptr, 10);
+	}
+
+	printf("bus: %llu B/s, %u writes per cycle\n", (unsigned long long)bytesPerSecond, (uint32_t)(sizeof(CYCLE_WRITES) / sizeof(CYCLE_WRITES[0])));
+	printf("%-13s | %12s | %12s | %8s\n", "", "frames/cycle", "bytes/cycle", "cycles/s");
+
+	for (bool writeBehind : {false, true}) {
+		Result result = measure(bytesPerSecond, writeBehind);
+		if (!result.ok) {
+			printf("writes failed\n");
+			return 1;
+		}
+
+		printf("%-13s | %12.1f | %12.1f | %8.1f\n", writeBehind ? "write-behind" : "direct",
+			result.framesPerCycle, result.bytesPerCycle, result.cyclesPerSecond);
+	}
+
+	return 0;
+}
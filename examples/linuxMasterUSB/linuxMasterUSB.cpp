@@ -40,10 +40,9 @@ int main() {
 		status = master.write(slave, 2000, &led, 1);
 		printf("Write status: %02xh\n", status);
 
-		while ((status = master.readStatus(slave)) & Busy) {
-		 	printf("waiting for Ok(0x80) status, received status =  %02xh\n", status);
-		 	usleep(500);
-		}
+		// Wait until slave's callback handled the change (up to 100 ms).
+		status = master.waitReady(slave, 100000);
+		printf("Ready status: %02xh\n", status);
 
 
 		// Read slave's led state and counter.
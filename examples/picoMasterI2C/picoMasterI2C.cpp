@@ -50,10 +50,9 @@ int main() {
 		status = master.write(SLAVE_I2C_ADDRESS, 0, &led, 1);
 		printf("Write status: %02xh\n", status);
 
-		while ((status = master.readStatus(SLAVE_I2C_ADDRESS)) & Busy) {
-		 	printf("waiting for Ok(0x80) status, received status =  %02xh\n", status);
-		 	sleep_ms(100);
-		}
+		// Wait until slave's callback handled the change (up to 100 ms).
+		status = master.waitReady(SLAVE_I2C_ADDRESS, 100000);
+		printf("Ready status: %02xh\n", status);
 
 
 		// Read slave's led state and counter.
@@ -0,0 +1,187 @@
+/*
+CommBatch.hpp
+
+CommBatch class collects reads and writes which master sends to slave in one batch frame.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <string.h>
+#include <cstdint>
+
+#include "CommStatus.hpp"
+#include "CommConstants.hpp"
+
+// Maximum number of operations in one batch, override with -DEMBEDDEDCOMM_MAX_BATCH_ENTRIES=N.
+#ifndef EMBEDDEDCOMM_MAX_BATCH_ENTRIES
+#define EMBEDDEDCOMM_MAX_BATCH_ENTRIES 32
+#endif
+
+// Maximum number of bytes slave sends back for one batch (status bytes and read data), override with
+// -DEMBEDDEDCOMM_MAX_BATCH_RESPONSE_SIZE=N. Master receives whole response on stack.
+#ifndef EMBEDDEDCOMM_MAX_BATCH_RESPONSE_SIZE
+#define EMBEDDEDCOMM_MAX_BATCH_RESPONSE_SIZE 1024
+#endif
+
+constexpr uint32_t MAX_BATCH_ENTRIES = EMBEDDEDCOMM_MAX_BATCH_ENTRIES;
+constexpr uint32_t MAX_BATCH_RESPONSE_SIZE = EMBEDDEDCOMM_MAX_BATCH_RESPONSE_SIZE;
+
+// Single read or write of a batch.
+struct CommBatchEntry {
+	BatchOperation operation;
+	uint32_t memoryAddress;
+	uint16_t length;
+	uint8_t *data; // Destination buffer for reads, source data for writes.
+	StatusValue status; // Valid after batch is executed.
+	uint8_t header[BATCH_ENTRY_HEADER_SIZE]; // Entry header as sent to slave.
+};
+
+// Slave applies all writes once request checksum is verified, then answers operations in order they were added.
+// Read overlapping write added after it is rejected with ErrInvalidRequest, as it would return data of that write.
+// Reads see writes added before them. Buffers passed to read()/write() must stay valid until batch is executed.
+class CommBatch {
+public:
+	CommBatch();
+
+	// Add read of length bytes starting at memoryAddress into buffer.
+	// Returns false if batch is full or response would exceed MAX_BATCH_RESPONSE_SIZE.
+	bool read(uint32_t memoryAddress, uint8_t *buffer, uint16_t length);
+
+	// Add write of length bytes from data starting at memoryAddress.
+	// Returns false if batch is full.
+	bool write(uint32_t memoryAddress, uint8_t *data, uint16_t length);
+
+	// Remove all operations.
+	void clear();
+
+	// Number of operations in batch.
+	uint32_t size() const;
+
+	// Status of operation with given index (in order of adding), valid after batch is executed.
+	StatusValue getStatus(uint32_t index) const;
+
+	// Operation with given index, used by master to build frame and store results.
+	CommBatchEntry &entry(uint32_t index);
+
+	// Number of bytes sent to slave after frame header (entry headers and write data).
+	uint32_t getRequestSize() const;
+
+	// Number of bytes slave sends back before checksum (status byte per entry and read data).
+	uint32_t getResponseSize() const;
+
+	// Set status of all operations, used when whole batch failed.
+	void setStatus(StatusValue status);
+
+private:
+	bool add(BatchOperation operation, uint32_t memoryAddress, uint8_t *data, uint16_t length);
+
+	CommBatchEntry entries[MAX_BATCH_ENTRIES];
+	uint32_t numberOfEntries;
+	uint32_t requestSize;
+	uint32_t responseSize;
+};
+
+inline CommBatch::CommBatch():
+	numberOfEntries(0),
+	requestSize(0),
+	responseSize(0)
+{}
+
+inline bool CommBatch::read(uint32_t memoryAddress, uint8_t *buffer, uint16_t length) {
+	if ( (length > 0) && (buffer == nullptr) ) {
+		return false;
+	}
+
+	if (responseSize + 1 + length > MAX_BATCH_RESPONSE_SIZE) {
+		return false;
+	}
+
+	return add(BatchRead, memoryAddress, buffer, length);
+}
+
+inline bool CommBatch::write(uint32_t memoryAddress, uint8_t *data, uint16_t length) {
+	if ( (length > 0) && (data == nullptr) ) {
+		return false;
+	}
+
+	if (responseSize + 1 > MAX_BATCH_RESPONSE_SIZE) {
+		return false;
+	}
+
+	return add(BatchWrite, memoryAddress, data, length);
+}
+
+inline bool CommBatch::add(BatchOperation operation, uint32_t memoryAddress, uint8_t *data, uint16_t length) {
+	if (numberOfEntries >= MAX_BATCH_ENTRIES) {
+		return false;
+	}
+
+	CommBatchEntry &entry = entries[numberOfEntries];
+	entry.operation = operation;
+	entry.memoryAddress = memoryAddress;
+	entry.length = length;
+	entry.data = data;
+	entry.status = NotUsed;
+
+	entry.header[0] = operation;
+	memcpy(&entry.header[1], &memoryAddress, sizeof(memoryAddress));
+	memcpy(&entry.header[5], &length, sizeof(length));
+
+	requestSize += BATCH_ENTRY_HEADER_SIZE;
+	responseSize += 1;
+
+	if (operation == BatchWrite) {
+		requestSize += length;
+	} else {
+		responseSize += length;
+	}
+
+	numberOfEntries++;
+
+	return true;
+}
+
+inline void CommBatch::clear() {
+	numberOfEntries = 0;
+	requestSize = 0;
+	responseSize = 0;
+}
+
+inline uint32_t CommBatch::size() const {
+	return numberOfEntries;
+}
+
+inline StatusValue CommBatch::getStatus(uint32_t index) const {
+	return (index < numberOfEntries) ? entries[index].status : (StatusValue)NotUsed;
+}
+
+inline CommBatchEntry &CommBatch::entry(uint32_t index) {
+	return entries[index];
+}
+
+inline uint32_t CommBatch::getRequestSize() const {
+	return requestSize;
+}
+
+inline uint32_t CommBatch::getResponseSize() const {
+	return responseSize;
+}
+
+inline void CommBatch::setStatus(StatusValue status) {
+	for (uint32_t i = 0; i < numberOfEntries; i++) {
+		entries[i].status = status;
+	}
+}
@@ -20,34 +20,336 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+
+// Available CRC8 engines. All of them produce identical results, they differ only in speed and flash usage.
+#define EMBEDDEDCOMM_CRC8_BITWISE 0 // No tables, eight iterations per byte.
+#define EMBEDDEDCOMM_CRC8_TABLE 1 // 256 byte table, one lookup per byte.
+#define EMBEDDEDCOMM_CRC8_SLICING 2 // Table for single bytes, 2 KB slicing-by-8 tables for buffers.
+
+// Select CRC8 engine at compile time (eg. -DEMBEDDEDCOMM_CRC8_ENGINE=EMBEDDEDCOMM_CRC8_BITWISE
+// on flash constrained slaves). By default hosts use slicing-by-8 and microcontrollers single table.
+#ifndef EMBEDDEDCOMM_CRC8_ENGINE
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+#define EMBEDDEDCOMM_CRC8_ENGINE EMBEDDEDCOMM_CRC8_SLICING
+#else
+#define EMBEDDEDCOMM_CRC8_ENGINE EMBEDDEDCOMM_CRC8_TABLE
+#endif
+#endif
+
+constexpr uint8_t CRC8_POLYNOMIAL = 0x07;
 
 // Calculate CRC8 (see https://en.wikipedia.org/wiki/Cyclic_redundancy_check)
-// using iterative method.
-inline uint8_t calculateChecksumIt(uint8_t checksum, uint8_t data) {
+// using iterative method, bit by bit.
+constexpr uint8_t calculateChecksumBitwise(uint8_t checksum, uint8_t data) {
 	checksum ^= data;
-    for (uint8_t i = 0; i < 8; i++) {
-        if (checksum & 0x80)
-            checksum = (checksum << 1) ^ 0x07;
-        else
-            checksum <<= 1;
-    }
+	for (uint8_t i = 0; i < 8; i++) {
+		if (checksum & 0x80)
+			checksum = (checksum << 1) ^ CRC8_POLYNOMIAL;
+		else
+			checksum <<= 1;
+	}
 
 	return checksum;
 }
 
+// Lookup tables generated at compile time. entries[k][x] holds CRC8 of byte x followed by k zero bytes,
+// so entries[0] is the classic single byte table and the rest are used by slicing-by-N variants.
+template <uint8_t N>
+struct Crc8Tables {
+	constexpr Crc8Tables(): entries{} {
+		for (uint32_t x = 0; x < 256; x++) {
+			entries[0][x] = calculateChecksumBitwise(0, (uint8_t)x);
+		}
+
+		for (uint8_t k = 1; k < N; k++) {
+			for (uint32_t x = 0; x < 256; x++) {
+				entries[k][x] = entries[0][entries[k-1][x]];
+			}
+		}
+	}
+
+	uint8_t entries[N][256];
+};
+
+// Tables are only placed in memory if the engine using them is referenced.
+inline constexpr Crc8Tables<1> CRC8_TABLE{};
+inline constexpr Crc8Tables<8> CRC8_SLICING_TABLES{};
+
+// Calculate CRC8 using single 256 byte lookup table.
+inline uint8_t calculateChecksumTable(uint8_t checksum, uint8_t data) {
+	return CRC8_TABLE.entries[0][checksum ^ data];
+}
+
+// Calculate CRC8 over buffer using slicing-by-N method (N = 4 or 8), N bytes are processed per iteration.
+template <uint8_t N>
+inline uint8_t calculateChecksumSlicing(const uint8_t *data, uint32_t size, uint8_t checksum) {
+	static_assert(N == 4 || N == 8, "Only slicing-by-4 and slicing-by-8 are supported");
+	const auto &t = CRC8_SLICING_TABLES.entries;
+
+	while (size >= N) {
+		uint8_t result = t[N-1][checksum ^ data[0]];
+		for (uint8_t k = 1; k < N; k++) {
+			result ^= t[N-1-k][data[k]];
+		}
+
+		checksum = result;
+		data += N;
+		size -= N;
+	}
+
+	while (size-- > 0) {
+		checksum = t[0][checksum ^ *data++];
+	}
+
+	return checksum;
+}
+
+// Calculate CRC8 (see https://en.wikipedia.org/wiki/Cyclic_redundancy_check)
+// for single byte, using engine selected with EMBEDDEDCOMM_CRC8_ENGINE.
+inline uint8_t calculateChecksumIt(uint8_t checksum, uint8_t data) {
+#if EMBEDDEDCOMM_CRC8_ENGINE == EMBEDDEDCOMM_CRC8_BITWISE
+	return calculateChecksumBitwise(checksum, data);
+#elif EMBEDDEDCOMM_CRC8_ENGINE == EMBEDDEDCOMM_CRC8_TABLE
+	return calculateChecksumTable(checksum, data);
+#else
+	return CRC8_SLICING_TABLES.entries[0][checksum ^ data];
+#endif
+}
+
 // Calculate CRC8 (see https://en.wikipedia.org/wiki/Cyclic_redundancy_check)
 // with defined start value.
-inline uint8_t  calculateChecksumAppend(uint8_t *data, uint32_t size, uint8_t startValue) {
+inline uint8_t calculateChecksumAppend(const uint8_t *data, uint32_t size, uint8_t startValue) {
+#if EMBEDDEDCOMM_CRC8_ENGINE == EMBEDDEDCOMM_CRC8_SLICING
+	return calculateChecksumSlicing<8>(data, size, startValue);
+#else
 	for (uint32_t i = 0; i < size; i++) {
 		startValue = calculateChecksumIt(startValue, data[i]);
 	}
 
 	return startValue;
+#endif
 }
 
 // Calculate CRC8 (see https://en.wikipedia.org/wiki/Cyclic_redundancy_check)
 // with 0 as start value.
-inline uint8_t calculateChecksum(uint8_t *data, uint32_t size) {
+inline uint8_t calculateChecksum(const uint8_t *data, uint32_t size) {
 	return calculateChecksumAppend(data, size, 0);
 }
 
+// Checksum modes which can be used in EmbeddedComm frames. Mode is chosen by master and
+// carried in every frame header, so slave always answers using the same mode.
+enum ChecksumMode : uint8_t {
+	ChecksumCRC8 = 0, // 1 byte, polynomial 0x07, initial value 0.
+	ChecksumCRC16 = 1, // 2 bytes, CRC16-CCITT (polynomial 0x1021, initial value 0xFFFF).
+	ChecksumCRC32C = 2 // 4 bytes, CRC32C Castagnoli (reflected polynomial 0x82F63B78, initial value and final xor 0xFFFFFFFF).
+};
+
+constexpr uint16_t CRC16_POLYNOMIAL = 0x1021;
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78; // Reflected.
+
+// Calculate CRC16-CCITT bit by bit.
+constexpr uint16_t calculateCrc16Bitwise(uint16_t checksum, uint8_t data) {
+	checksum ^= (uint16_t)data << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		if (checksum & 0x8000)
+			checksum = (checksum << 1) ^ CRC16_POLYNOMIAL;
+		else
+			checksum <<= 1;
+	}
+
+	return checksum;
+}
+
+// Calculate CRC32C bit by bit.
+constexpr uint32_t calculateCrc32cBitwise(uint32_t checksum, uint8_t data) {
+	checksum ^= data;
+	for (uint8_t i = 0; i < 8; i++) {
+		if (checksum & 1)
+			checksum = (checksum >> 1) ^ CRC32C_POLYNOMIAL;
+		else
+			checksum >>= 1;
+	}
+
+	return checksum;
+}
+
+// Single byte lookup tables for wide checksums generated at compile time.
+struct WideChecksumTables {
+	constexpr WideChecksumTables(): crc16{}, crc32c{} {
+		for (uint32_t x = 0; x < 256; x++) {
+			crc16[x] = calculateCrc16Bitwise(0, (uint8_t)x);
+			crc32c[x] = calculateCrc32cBitwise(0, (uint8_t)x);
+		}
+	}
+
+	uint16_t crc16[256];
+	uint32_t crc32c[256];
+};
+
+inline constexpr WideChecksumTables WIDE_CHECKSUM_TABLES{};
+
+inline uint16_t calculateCrc16It(uint16_t checksum, uint8_t data) {
+#if EMBEDDEDCOMM_CRC8_ENGINE == EMBEDDEDCOMM_CRC8_BITWISE
+	return calculateCrc16Bitwise(checksum, data);
+#else
+	return (checksum << 8) ^ WIDE_CHECKSUM_TABLES.crc16[(checksum >> 8) ^ data];
+#endif
+}
+
+inline uint32_t calculateCrc32cIt(uint32_t checksum, uint8_t data) {
+#if EMBEDDEDCOMM_CRC8_ENGINE == EMBEDDEDCOMM_CRC8_BITWISE
+	return calculateCrc32cBitwise(checksum, data);
+#else
+	return (checksum >> 8) ^ WIDE_CHECKSUM_TABLES.crc32c[(checksum ^ data) & 0xFF];
+#endif
+}
+
+// Table based CRC32C over buffer, working on raw (not finalized) checksum value.
+inline uint32_t calculateCrc32cTable(const uint8_t *data, uint32_t size, uint32_t checksum) {
+	for (uint32_t i = 0; i < size; i++) {
+		checksum = calculateCrc32cIt(checksum, data[i]);
+	}
+
+	return checksum;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EMBEDDEDCOMM_CRC32C_HW 1
+
+#include <nmmintrin.h>
+
+// CRC32C using SSE4.2 crc32 instruction, 8 bytes per instruction.
+__attribute__((target("sse4.2")))
+inline uint32_t calculateCrc32cHardware(const uint8_t *data, uint32_t size, uint32_t checksum) {
+	uint64_t checksum64 = checksum;
+	while (size >= 8) {
+		uint64_t chunk;
+		memcpy(&chunk, data, 8);
+		checksum64 = _mm_crc32_u64(checksum64, chunk);
+		data += 8;
+		size -= 8;
+	}
+
+	checksum = (uint32_t)checksum64;
+	while (size-- > 0) {
+		checksum = _mm_crc32_u8(checksum, *data++);
+	}
+
+	return checksum;
+}
+
+// Returns true if CPU supports SSE4.2 and hardware results match table based implementation.
+inline bool crc32cHardwareUsable() {
+	static const bool usable = [] {
+		if (!__builtin_cpu_supports("sse4.2")) {
+			return false;
+		}
+
+		uint8_t probe[61];
+		for (uint32_t i = 0; i < sizeof(probe); i++) {
+			probe[i] = (uint8_t)(i * 37 + 11);
+		}
+
+		for (uint32_t size = 0; size <= sizeof(probe); size++) {
+			if (calculateCrc32cHardware(probe, size, 0xFFFFFFFF) != calculateCrc32cTable(probe, size, 0xFFFFFFFF)) {
+				return false;
+			}
+		}
+
+		return true;
+	}();
+
+	return usable;
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define EMBEDDEDCOMM_CRC32C_HW 1
+
+#include <arm_acle.h>
+
+// CRC32C using ARMv8 crc32c instructions, 8 bytes per instruction.
+inline uint32_t calculateCrc32cHardware(const uint8_t *data, uint32_t size, uint32_t checksum) {
+	while (size >= 8) {
+		uint64_t chunk;
+		memcpy(&chunk, data, 8);
+		checksum = __crc32cd(checksum, chunk);
+		data += 8;
+		size -= 8;
+	}
+
+	while (size-- > 0) {
+		checksum = __crc32cb(checksum, *data++);
+	}
+
+	return checksum;
+}
+
+inline bool crc32cHardwareUsable() {
+	return true;
+}
+
+#else
+#define EMBEDDEDCOMM_CRC32C_HW 0
+#endif
+
+// Size of checksum in bytes for given mode.
+inline uint32_t checksumSize(ChecksumMode mode) {
+	switch (mode) {
+	case ChecksumCRC16:
+		return 2;
+	case ChecksumCRC32C:
+		return 4;
+	default:
+		return 1;
+	}
+}
+
+// Checksum value before first byte is processed.
+inline uint32_t checksumInit(ChecksumMode mode) {
+	switch (mode) {
+	case ChecksumCRC16:
+		return 0xFFFF;
+	case ChecksumCRC32C:
+		return 0xFFFFFFFF;
+	default:
+		return 0;
+	}
+}
+
+// Update checksum of given mode with single byte.
+inline uint32_t checksumUpdate(ChecksumMode mode, uint32_t checksum, uint8_t data) {
+	switch (mode) {
+	case ChecksumCRC16:
+		return calculateCrc16It((uint16_t)checksum, data);
+	case ChecksumCRC32C:
+		return calculateCrc32cIt(checksum, data);
+	default:
+		return calculateChecksumIt((uint8_t)checksum, data);
+	}
+}
+
+// Update checksum of given mode with buffer.
+inline uint32_t checksumUpdate(ChecksumMode mode, uint32_t checksum, const uint8_t *data, uint32_t size) {
+	switch (mode) {
+	case ChecksumCRC8:
+		return calculateChecksumAppend(data, size, (uint8_t)checksum);
+	case ChecksumCRC32C:
+#if EMBEDDEDCOMM_CRC32C_HW
+		if (crc32cHardwareUsable()) {
+			return calculateCrc32cHardware(data, size, checksum);
+		}
+#endif
+		return calculateCrc32cTable(data, size, checksum);
+	default:
+		for (uint32_t i = 0; i < size; i++) {
+			checksum = checksumUpdate(mode, checksum, data[i]);
+		}
+		return checksum;
+	}
+}
+
+// Value which is transmitted, once all bytes are processed.
+inline uint32_t checksumFinalize(ChecksumMode mode, uint32_t checksum) {
+	return (mode == ChecksumCRC32C) ? (checksum ^ 0xFFFFFFFF) : checksum;
+}
@@ -22,5 +22,89 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #include <cstdint>
 
 constexpr uint32_t SLAVE_ADDRESS_SIZE = 4; // Size of slave's memory addresses in bytes.
-constexpr uint32_t CHECKSUM_SIZE = 1;
+constexpr uint32_t FRAME_HEADER_SIZE = SLAVE_ADDRESS_SIZE * 2; // Data length field followed by memory address.
+constexpr uint32_t MAX_CHECKSUM_SIZE = 4; // Size of the widest checksum (CRC32C) in bytes.
+
+// Data length field layout. Upper bits carry frame flags, remaining ones the actual length.
+constexpr uint32_t READ_FLAG = 1u << 31; // Set if master reads data.
+constexpr uint32_t CHECKSUM_MODE_SHIFT = 29; // Bits 29-30 hold ChecksumMode used in the frame.
+constexpr uint32_t CHECKSUM_MODE_MASK = 3u << CHECKSUM_MODE_SHIFT;
+constexpr uint32_t EXTENDED_FLAG = 1u << 28; // Set in extended frames, memory address field carries opcode instead.
+constexpr uint32_t DATA_LENGTH_MASK = EXTENDED_FLAG - 1;
+
+// Memory address field of extended frame: opcode in the lowest byte, size of slave's response in the remaining ones.
+constexpr uint32_t EXTENDED_OPCODE_MASK = 0xFF;
+constexpr uint32_t EXTENDED_RESPONSE_SHIFT = 8;
+constexpr uint32_t MAX_EXTENDED_RESPONSE_SIZE = UINT32_MAX >> EXTENDED_RESPONSE_SHIFT;
+
+// Encoding of frame header, selected at runtime (master and slave must agree).
+enum HeaderEncoding : uint8_t {
+	HeaderFixed = 0, // Fields of width given by profile.
+	HeaderVarint = 1 // Both fields LEB128 encoded, small lengths and addresses take single byte each.
+};
+
+// Varint header: data length field followed by memory address field, each LEB128 encoded
+// (7 bits per byte, least significant first, the highest bit set if more bytes follow).
+// The lowest bits of data length field carry flags: read flag, extended frame flag and checksum mode
+// (2 bits, only if profile carries it), data length is stored above them.
+constexpr uint32_t VARINT_READ_FLAG = 1u << 0;
+constexpr uint32_t VARINT_EXTENDED_FLAG = 1u << 1;
+constexpr uint32_t VARINT_CHECKSUM_MODE_SHIFT = 2;
+constexpr uint32_t MAX_VARINT_SIZE = 5; // Bytes needed to encode 32 bit value.
+constexpr uint32_t MAX_VARINT_HEADER_SIZE = MAX_VARINT_SIZE * 2;
+constexpr uint32_t MAX_HEADER_SIZE = MAX_VARINT_HEADER_SIZE; // The longest header of any profile and encoding.
+
+// Operations carried by extended frames.
+enum ExtendedOpcode : uint8_t {
+	OpBatch = 1, // List of reads and writes executed in one transaction.
+	OpAtomic = 2, // Read-modify-write of single field executed by slave.
+	OpDirtyMap = 3, // Read and clear map of memory pages changed since previous read.
+	OpLimits = 4 // Read sizes limiting transfers accepted by slave.
+};
+
+// Batch request entry: operation (1 byte), memory address (4 bytes), length (2 bytes), followed by data for writes.
+// Slave answers each entry with status byte, followed by data for reads.
+constexpr uint32_t BATCH_ENTRY_HEADER_SIZE = 7;
+
+enum BatchOperation : uint8_t {
+	BatchRead = 0,
+	BatchWrite = 1
+};
+
+// Dirty map request: first page (4 bytes), number of pages (4 bytes). Slave answers with bitmap
+// of (number of pages + 7) / 8 bytes, bit i (LSB first) set if page first page + i changed.
+constexpr uint32_t DIRTY_MAP_REQUEST_SIZE = 8;
+
+// Limits request carries no data (slave answers it even without request buffer). Slave answers with memory size,
+// maximum size of write frame data and size of request buffer (0 if extended frames are disabled), 4 bytes each.
+constexpr uint32_t SLAVE_LIMITS_SIZE = 12;
+
+// Status frame: data length field only, with read and extended flags set. Slave answers with status byte.
+// Length STATUS_FRAME_LENGTH is answered at once, READY_FRAME_LENGTH once slave is not Busy (after process()
+// executed pending callbacks), so master may block on the answer instead of polling.
+constexpr uint32_t STATUS_FRAME_LENGTH = 0;
+constexpr uint32_t READY_FRAME_LENGTH = 1;
+
+// Stream window occupies two addresses, frame addressed to memoryAddress + sequence bit (alternated by master
+// after every successful transfer) accesses the stream. Frame with the same sequence bit as the previous one
+// repeats it: read returns the same bytes, write is not applied again.
+// Read response data starts with number of stream bytes (little endian), followed by stream bytes
+// and zero padding up to requested length.
+constexpr uint32_t STREAM_WINDOW_SIZE = 2;
+constexpr uint32_t STREAM_COUNT_SIZE = 2;
+constexpr uint32_t MAX_STREAM_READ_SIZE = UINT16_MAX; // Stream bytes returned by one read.
+
+// Atomic request: operation (1 byte), field width (1 byte: 1, 2 or 4), memory address (4 bytes), operand (width bytes),
+// followed by new value (width bytes) for compare-and-swap. Fields are little endian.
+// Slave answers with status byte followed by value of the field before modification (width bytes).
+constexpr uint32_t ATOMIC_REQUEST_HEADER_SIZE = 6;
+constexpr uint32_t MAX_ATOMIC_REQUEST_SIZE = ATOMIC_REQUEST_HEADER_SIZE + 4*2;
+
+enum AtomicOperation : uint8_t {
+	AtomicFetchAdd = 0, // field += operand
+	AtomicCompareSwap = 1, // field = new value, if field == operand
+	AtomicSetBits = 2, // field |= operand
+	AtomicClearBits = 3, // field &= ~operand
+	AtomicSwap = 4 // field = operand
+};
 	
@@ -0,0 +1,71 @@
+/*
+CommProfile.hpp
+
+Protocol profiles select widths of frame header fields and checksum at compile time.
+Master and slave must use the same profile.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "CommChecksum.hpp"
+#include "CommConstants.hpp"
+
+// addressSize and lengthSize are widths (1, 2 or 4 bytes) of memory address and data length fields.
+// If checksumInHeader is set, master chooses checksum mode per frame and carries it in data length field
+// (checksum is then the default mode), otherwise every frame uses given checksum and field is not spent on it.
+//
+// Data length field layout, from the most significant bit: read flag, checksum mode (2 bits, if carried),
+// extended frame flag, data length in the remaining bits.
+template <uint8_t addressSize, uint8_t lengthSize, ChecksumMode checksum, bool checksumInHeader = false>
+struct CommProfile {
+	static_assert( (addressSize == 1) || (addressSize == 2) || (addressSize == 4), "address field must be 1, 2 or 4 bytes");
+	static_assert( (lengthSize == 1) || (lengthSize == 2) || (lengthSize == 4), "length field must be 1, 2 or 4 bytes");
+
+	static constexpr uint32_t ADDRESS_SIZE = addressSize;
+	static constexpr uint32_t LENGTH_SIZE = lengthSize;
+	static constexpr uint32_t HEADER_SIZE = lengthSize + addressSize;
+
+	static constexpr bool CHECKSUM_IN_HEADER = checksumInHeader;
+	static constexpr ChecksumMode CHECKSUM_MODE = checksum;
+
+	static constexpr uint32_t READ_FLAG = 1u << (lengthSize*8 - 1);
+	static constexpr uint32_t CHECKSUM_MODE_SHIFT = lengthSize*8 - 3;
+	static constexpr uint32_t CHECKSUM_MODE_MASK = checksumInHeader ? (3u << CHECKSUM_MODE_SHIFT) : 0;
+	static constexpr uint32_t EXTENDED_FLAG = 1u << (lengthSize*8 - (checksumInHeader ? 4 : 2));
+	static constexpr uint32_t DATA_LENGTH_MASK = EXTENDED_FLAG - 1;
+
+	// Highest memory address which fits into address field.
+	static constexpr uint32_t MAX_ADDRESS = (addressSize == 4) ? UINT32_MAX : ((1u << (addressSize*8)) - 1);
+
+	// Address field of extended frame carries opcode in the lowest byte, response size in the remaining ones
+	// (so extended frames need at least 2 byte addresses).
+	static constexpr uint32_t MAX_EXTENDED_RESPONSE_SIZE = MAX_ADDRESS >> EXTENDED_RESPONSE_SHIFT;
+};
+
+// Original frame layout: 4 byte fields, checksum mode chosen by master. Used by default.
+using DefaultProfile = CommProfile<4, 4, ChecksumCRC8, true>;
+
+// Up to 64 KB of memory, transfers up to 16383 bytes, CRC8. Header takes 4 bytes.
+using CompactProfile = CommProfile<2, 2, ChecksumCRC8>;
+
+// Register maps up to 256 bytes, transfers up to 63 bytes, CRC8. Header takes 2 bytes, extended frames are not available.
+using TinyProfile = CommProfile<1, 1, ChecksumCRC8>;
+
+static_assert( (DefaultProfile::HEADER_SIZE == FRAME_HEADER_SIZE) && (DefaultProfile::READ_FLAG == READ_FLAG) &&
+	(DefaultProfile::CHECKSUM_MODE_MASK == CHECKSUM_MODE_MASK) && (DefaultProfile::EXTENDED_FLAG == EXTENDED_FLAG) &&
+	(DefaultProfile::MAX_EXTENDED_RESPONSE_SIZE == MAX_EXTENDED_RESPONSE_SIZE), "default profile must match original frame layout");
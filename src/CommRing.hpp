@@ -0,0 +1,229 @@
+/*
+CommRing.hpp
+
+CommRing class is a wait-free single producer, single consumer byte ring,
+used to pass bytes between interrupt handler and main loop.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <string.h>
+#include <atomic>
+#include <cstdint>
+
+// Only one context may push and only one (possibly different) context may pop at a time.
+// Indexes run freely and are masked on access, so whole buffer is usable.
+class CommRing {
+public:
+	CommRing();
+
+	// Pass pointer to buffer used as storage, size must be power of 2. Ring is emptied.
+	// Returns false if size is not power of 2 (ring stays unusable).
+	bool initialize(uint8_t *buffer, uint32_t size);
+
+	// Producer side. Returns false if ring is full.
+	bool push(uint8_t byte);
+
+	// Producer side. Push up to size bytes, returns number of bytes pushed.
+	uint32_t push(const uint8_t *bytes, uint32_t size);
+
+	// Consumer side. Returns false if ring is empty.
+	bool pop(uint8_t &byte);
+
+	// Consumer side. Pop up to size bytes, returns number of bytes popped.
+	uint32_t pop(uint8_t *bytes, uint32_t size);
+
+	// Consumer side. Copy up to size bytes, starting offset bytes after the oldest one, without removing them.
+	// Returns number of bytes copied.
+	uint32_t peek(uint8_t *bytes, uint32_t size, uint32_t offset = 0) const;
+
+	// Consumer side. Remove up to size oldest bytes, returns number of bytes removed.
+	uint32_t discard(uint32_t size);
+
+	// Producer side. Copy up to size bytes, starting offset bytes after the newest one, without making them
+	// available to consumer. Returns number of bytes copied.
+	uint32_t stage(const uint8_t *bytes, uint32_t size, uint32_t offset);
+
+	// Producer side. Make up to size staged bytes available to consumer.
+	void commit(uint32_t size);
+
+	// Number of bytes which can be popped. Exact for consumer, lower bound for producer.
+	uint32_t available() const;
+
+	// Number of bytes which can be pushed. Exact for producer, lower bound for consumer.
+	uint32_t space() const;
+
+	uint32_t capacity() const;
+
+private:
+	uint8_t *buffer;
+	uint32_t mask;
+	std::atomic<uint32_t> head; // Written by producer only.
+	std::atomic<uint32_t> tail; // Written by consumer only.
+};
+
+inline CommRing::CommRing():
+	buffer(nullptr),
+	mask(0),
+	head(0),
+	tail(0)
+{}
+
+inline bool CommRing::initialize(uint8_t *buffer, uint32_t size) {
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+
+	if ( (buffer == nullptr) || (size == 0) || ((size & (size - 1)) != 0) ) {
+		this->buffer = nullptr;
+		mask = 0;
+		return false;
+	}
+
+	this->buffer = buffer;
+	mask = size - 1;
+	return true;
+}
+
+inline bool CommRing::push(uint8_t byte) {
+	const uint32_t h = head.load(std::memory_order_relaxed);
+
+	if ( (buffer == nullptr) || (h - tail.load(std::memory_order_acquire) > mask) ) {
+		return false;
+	}
+
+	buffer[h & mask] = byte;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+inline uint32_t CommRing::push(const uint8_t *bytes, uint32_t size) {
+	if (buffer == nullptr) {
+		return 0;
+	}
+
+	const uint32_t h = head.load(std::memory_order_relaxed);
+	const uint32_t free = (mask + 1) - (h - tail.load(std::memory_order_acquire));
+	const uint32_t n = (size < free) ? size : free;
+
+	// Copy in up to two parts, if data wraps around end of buffer.
+	const uint32_t offset = h & mask;
+	const uint32_t first = (n < mask + 1 - offset) ? n : (mask + 1 - offset);
+	memcpy(&buffer[offset], bytes, first);
+	memcpy(buffer, bytes + first, n - first);
+
+	head.store(h + n, std::memory_order_release);
+	return n;
+}
+
+inline bool CommRing::pop(uint8_t &byte) {
+	const uint32_t t = tail.load(std::memory_order_relaxed);
+
+	if ( (buffer == nullptr) || (head.load(std::memory_order_acquire) == t) ) {
+		return false;
+	}
+
+	byte = buffer[t & mask];
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+inline uint32_t CommRing::pop(uint8_t *bytes, uint32_t size) {
+	if (buffer == nullptr) {
+		return 0;
+	}
+
+	const uint32_t t = tail.load(std::memory_order_relaxed);
+	const uint32_t used = head.load(std::memory_order_acquire) - t;
+	const uint32_t n = (size < used) ? size : used;
+
+	const uint32_t offset = t & mask;
+	const uint32_t first = (n < mask + 1 - offset) ? n : (mask + 1 - offset);
+	memcpy(bytes, &buffer[offset], first);
+	memcpy(bytes + first, buffer, n - first);
+
+	tail.store(t + n, std::memory_order_release);
+	return n;
+}
+
+inline uint32_t CommRing::peek(uint8_t *bytes, uint32_t size, uint32_t offset) const {
+	if (buffer == nullptr) {
+		return 0;
+	}
+
+	const uint32_t t = tail.load(std::memory_order_relaxed);
+	const uint32_t used = head.load(std::memory_order_acquire) - t;
+	if (offset >= used) {
+		return 0;
+	}
+
+	const uint32_t n = (size < used - offset) ? size : (used - offset);
+
+	const uint32_t start = (t + offset) & mask;
+	const uint32_t first = (n < mask + 1 - start) ? n : (mask + 1 - start);
+	memcpy(bytes, &buffer[start], first);
+	memcpy(bytes + first, buffer, n - first);
+
+	return n;
+}
+
+inline uint32_t CommRing::discard(uint32_t size) {
+	const uint32_t t = tail.load(std::memory_order_relaxed);
+	const uint32_t used = head.load(std::memory_order_acquire) - t;
+	const uint32_t n = (size < used) ? size : used;
+
+	tail.store(t + n, std::memory_order_release);
+	return n;
+}
+
+inline uint32_t CommRing::stage(const uint8_t *bytes, uint32_t size, uint32_t offset) {
+	if (buffer == nullptr) {
+		return 0;
+	}
+
+	const uint32_t h = head.load(std::memory_order_relaxed);
+	const uint32_t free = (mask + 1) - (h - tail.load(std::memory_order_acquire));
+	if (offset >= free) {
+		return 0;
+	}
+
+	const uint32_t n = (size < free - offset) ? size : (free - offset);
+
+	const uint32_t start = (h + offset) & mask;
+	const uint32_t first = (n < mask + 1 - start) ? n : (mask + 1 - start);
+	memcpy(&buffer[start], bytes, first);
+	memcpy(buffer, bytes + first, n - first);
+
+	return n;
+}
+
+inline void CommRing::commit(uint32_t size) {
+	const uint32_t free = space();
+	const uint32_t n = (size < free) ? size : free;
+
+	head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+inline uint32_t CommRing::available() const {
+	return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+inline uint32_t CommRing::space() const {
+	return (buffer == nullptr) ? 0 : (mask + 1) - available();
+}
+
+inline uint32_t CommRing::capacity() const {
+	return (buffer == nullptr) ? 0 : mask + 1;
+}
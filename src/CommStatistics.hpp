@@ -0,0 +1,142 @@
+/*
+CommStatistics.hpp
+
+Transport statistics collected by EmbeddedComm masters and slaves.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "CommStatus.hpp"
+
+// Enable statistics at compile time with -DEMBEDDEDCOMM_STATS=1. Define it the same way for all translation units
+// (library and application), as it changes layout of master and slave classes. Disabled by default, statistics
+// code is then not compiled at all.
+#ifndef EMBEDDEDCOMM_STATS
+#define EMBEDDEDCOMM_STATS 0
+#endif
+
+// Latency histogram of master frames and slave's callback and Busy times additionally need -DEMBEDDEDCOMM_STATS_TIMING=1.
+// They read clock two times per master frame and up to three times per slave frame, without it statistics
+// only increment counters and timing fields stay zero. Define it the same way for all translation units too.
+#ifndef EMBEDDEDCOMM_STATS_TIMING
+#define EMBEDDEDCOMM_STATS_TIMING 0
+#endif
+
+#if EMBEDDEDCOMM_STATS_TIMING && !EMBEDDEDCOMM_STATS
+#error "EMBEDDEDCOMM_STATS_TIMING requires EMBEDDEDCOMM_STATS"
+#endif
+
+// Histogram of latencies in microseconds with logarithmic buckets of constant relative precision (like HDR histograms):
+// values below 2^SUB_BUCKET_BITS have own buckets, every following power of 2 is split into 2^SUB_BUCKET_BITS buckets,
+// so values are stored with 12.5% precision. Recording takes a few instructions and no memory allocation.
+struct CommLatencyHistogram {
+	static constexpr uint32_t SUB_BUCKET_BITS = 3;
+	static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+	static constexpr uint32_t NUMBER_OF_BUCKETS = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	uint32_t counts[NUMBER_OF_BUCKETS] = {};
+	uint64_t count = 0;
+	uint32_t max = 0;
+
+	void record(uint32_t valueUs) {
+		counts[bucket(valueUs)]++;
+		count++;
+		max = (valueUs > max) ? valueUs : max;
+	}
+
+	// Upper bound of the smallest bucket holding at least given fraction (0.0 - 1.0) of recorded values, 0 if empty.
+	uint32_t percentile(double fraction) const {
+		const uint64_t target = (uint64_t)(fraction * count + 0.5);
+		uint64_t seen = 0;
+
+		for (uint32_t i = 0; i < NUMBER_OF_BUCKETS; i++) {
+			seen += counts[i];
+			if ( (counts[i] > 0) && (seen >= target) ) {
+				const uint32_t upper = (i + 1 < NUMBER_OF_BUCKETS) ? (lowerBound(i + 1) - 1) : UINT32_MAX;
+				return (upper < max) ? upper : max;
+			}
+		}
+
+		return 0;
+	}
+
+	static uint32_t bucket(uint32_t value) {
+		if (value < SUB_BUCKETS) {
+			return value;
+		}
+
+		const uint32_t msb = 31 - __builtin_clz(value);
+		const uint32_t shift = msb - SUB_BUCKET_BITS;
+		return ((shift + 1) << SUB_BUCKET_BITS) + ((value >> shift) - SUB_BUCKETS);
+	}
+
+	// The smallest value stored in given bucket.
+	static uint32_t lowerBound(uint32_t bucket) {
+		if (bucket < SUB_BUCKETS) {
+			return bucket;
+		}
+
+		const uint32_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+		return (SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << shift;
+	}
+};
+
+// Frames exchanged by master with one slave. Frames not sent at all (eg. address out of profile's range) are not counted.
+struct CommMasterStatistics {
+	uint64_t frames = 0;
+	uint64_t bytesOut = 0; // Bytes sent to slave, including headers and checksums.
+	uint64_t bytesIn = 0; // Bytes received from slave, including checksums and status.
+	uint64_t checksumErrors = 0; // Frames with ErrDataCorrupted, detected by either side.
+	uint64_t transportErrors = 0; // Frames failed by writeBytes()/readBytes() (status 0).
+	uint64_t retries = 0; // Frames repeated by retry policy (see GenericMaster::setRetryPolicy()).
+	uint64_t statusCounts[8] = {}; // Frames with given status bit set, bit i is counted at index i (eg. Busy at 5).
+	CommLatencyHistogram latency; // Duration of whole frames, only with EMBEDDEDCOMM_STATS_TIMING.
+
+	void recordFrame(uint32_t out, uint32_t in, StatusValue status) {
+		frames++;
+		bytesOut += out;
+		bytesIn += in;
+
+		if (status == NotUsed) {
+			transportErrors++;
+		}
+		if (status & ErrDataCorrupted) {
+			checksumErrors++;
+		}
+		for (uint32_t i = 0; i < 8; i++) {
+			statusCounts[i] += (status >> i) & 1;
+		}
+	}
+};
+
+// Counters of a slave. Fields are 32 bit little endian words, so master reads them from slave's statistics
+// window straight into this structure (see GenericSlave::enableStatisticsWindow()). Times are in microseconds,
+// only with EMBEDDEDCOMM_STATS_TIMING.
+struct CommSlaveStatistics {
+	uint32_t frames = 0; // Frames answered with status byte.
+	uint32_t bytesReceived = 0; // Bytes passed to write handlers (interrupt handler work).
+	uint32_t bytesSent = 0; // Bytes returned by read handlers.
+	uint32_t checksumErrors = 0; // Frames received with checksum mismatch.
+	uint32_t backupRestores = 0; // Memory restored from backup buffer after corrupted write.
+	uint32_t callbacksExecuted = 0; // Memory change callbacks invoked by process().
+	uint32_t callbackTimeUs = 0; // Total time spent in callbacks.
+	uint32_t maxCallbackTimeUs = 0; // The longest process() call executing callbacks.
+	uint32_t busyTimeUs = 0; // Total time slave answered Busy, from frame end until process() cleared it.
+};
+
+static_assert(sizeof(CommSlaveStatistics) == 9 * sizeof(uint32_t), "slave statistics are read as array of words");
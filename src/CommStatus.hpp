@@ -31,7 +31,7 @@ enum CommStatus {
 	// Memory address is not valid, falls outside memory range.
 	ErrMemoryOutOfRange = 1,
 
-	// Slave's backup buffer overflowed, once backups are enabled maximum write size must not exceed backup buffer size.
+	// Slave's backup buffer overflowed, once backups (or staged writes) are enabled maximum write size must not exceed buffer size.
 	ErrBackupBufferOverflow = 2,
 		
 	// Master wanted to read data, but did not write dataLen or/and memoryAddress previously.
@@ -45,6 +45,10 @@ enum CommStatus {
 
 	// Slave is not ready for read/write requests (eg. memory backup needs to be restored). 
 	Busy = 32,
+
+	// Frame header is malformed (eg. reserved checksum mode, too long varint field), or extended frame is not supported by slave,
+	// malformed or does not fit into slave's request buffer.
+	ErrInvalidRequest = 64,
 	
 	// Status indicates no errors
 	Ok = 128
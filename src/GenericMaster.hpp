@@ -22,113 +22,1167 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #pragma once
 
 #include <string.h>
+#include <type_traits>
+
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+#include <chrono>
+#include <thread>
+#endif
 
 #include "CommStatus.hpp"
 #include "CommChecksum.hpp"
 #include "CommConstants.hpp"
+#include "CommBatch.hpp"
+#include "CommProfile.hpp"
+#include "CommStatistics.hpp"
+
+// Continuous part of a frame, used by vectored transfers.
+struct CommSegment {
+	uint8_t *data;
+	uint32_t size;
+};
+
+// Repeating of failed idempotent transactions, see GenericMaster::setRetryPolicy().
+struct CommRetryPolicy {
+	uint32_t maxAttempts = 1; // Attempts including the first one, 1 disables retries.
+	uint32_t initialDelayUs = 10; // Delay before the first retry.
+	uint32_t backoffFactor = 2; // Delay is multiplied by it after every retry (1 keeps it constant)...
+	uint32_t maxDelayUs = 1000; // ...up to this value.
+	StatusValue retryOn = ErrDataCorrupted | Busy; // Statuses with any of these flags are retried.
+	bool retryTransportErrors = true; // Retry transactions failed by writeBytes()/readBytes() (status 0).
+	uint32_t readyTimeoutUs = 10000; // Writes and Busy frames are retried once slave is ready (waitReady()), within this time.
+};
+
+// Sizes limiting transfers accepted by slave, see GenericMaster::readSlaveLimits().
+struct CommSlaveLimits {
+	uint32_t memorySize = 0;
+	uint32_t maxWriteSize = 0; // Data of single write frame (size of slave's staging or backup buffer).
+	uint32_t requestBufferSize = 0; // Request of single extended frame, 0 if slave has extended frames disabled.
+};
 
 // Template implementation allows flexibility for child classes in defining slave information types.
-template <typename slaveInfo>
+// Profile selects widths of frame header fields and checksum (see CommProfile.hpp), slaves must use the same one.
+template <typename slaveInfo, typename Profile = DefaultProfile>
 class GenericMaster {
 public:
 	GenericMaster();
 	
 	// Write bytes to (pointed by sinfo parameter) slave's memory starting with given address.
 	// Keep in mind that write to slave is limited by its receive buffer capacity (minus one byte to account for checksum).
+	// Use writeLarge() to split longer writes according to slave's limits.
 	// As return value, pass code returned by some hardware-specific write function from child class. 
-	StatusValue write(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize);
+	// Failed write is repeated according to retry policy (see setRetryPolicy()), if attempts is given
+	// it receives number of frames sent. The same applies to read(), execute(), readStream() and writeStream().
+	StatusValue write(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize, uint32_t *attempts = nullptr);
 	
 	// Read bytes from (pointed by sinfo parameter) slave's memory starting with given address,
 	// load data into buffer. Ensure buffer has atleast readSize bytes.
 	// As return value, pass code returned by some hardware-specific read function from child class. 
-	StatusValue read(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize);
+	StatusValue read(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize, uint32_t *attempts = nullptr);
 	
-	// Read zero data bytes from slave, to get status value
+	// Execute all operations of batch in one frame. Returns status of the frame, status of every operation
+	// is stored in batch. If frame fails, all operations get its status. Slave must have request buffer
+	// large enough for batch.getRequestSize(), otherwise ErrInvalidRequest is returned.
+	StatusValue execute(slaveInfo &sinfo, CommBatch &batch, uint32_t *attempts = nullptr);
+
+	// Read up to size bytes queued in slave's stream window (see GenericSlave::addStreamWindow()),
+	// count receives number of stream bytes stored in buffer. Keep one sequence variable (initially 0) per window
+	// and pass it to every call. It advances only after successful read, so bytes of failed read are returned again
+	// by the next call and no bytes are lost or duplicated. At most MAX_STREAM_READ_SIZE bytes are read at once.
+	StatusValue readStream(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *buffer, uint32_t size, uint32_t &count, uint8_t &sequence, uint32_t *attempts = nullptr);
+
+	// Push size bytes into slave's stream window, all of them or none (ErrBackupBufferOverflow if they do not fit).
+	// Sequence works as in readStream() (use separate variable for writes), so repeating failed write
+	// never pushes data twice.
+	StatusValue writeStream(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *data, uint32_t size, uint8_t &sequence, uint32_t *attempts = nullptr);
+
+	// Read and clear slave's map of pages changed since previous request (see GenericSlave::enableDirtyTracking()).
+	// Bit i (LSB first) of bitmap is set if page firstPage + i changed, bitmap must hold (numberOfPages + 7) / 8 bytes.
+	// Pages are cleared once reported, so if read fails, changes may be lost and pages must be read anyway.
+	// It is never retried, as repeated request would not report pages cleared by the failed one.
+	StatusValue readDirtyMap(slaveInfo &sinfo, uint32_t firstPage, uint32_t numberOfPages, uint8_t *bitmap);
+
+	// Update buffer mirroring length bytes of slave's memory starting with memoryAddress (multiple of pageSize,
+	// the same as slave's page size) by reading only pages changed since previous call, in as few batches as possible.
+	// Slave's request buffer must hold MAX_BATCH_ENTRIES * BATCH_ENTRY_HEADER_SIZE bytes. First call reads whole region,
+	// as slave starts with all pages dirty. If it fails, buffer may miss changes, read whole region with read()
+	// before relying on it again.
+	StatusValue readDirtyPages(slaveInfo &sinfo, uint32_t memoryAddress, uint32_t length, uint32_t pageSize, uint8_t *buffer);
+
+	// Read sizes limiting transfers accepted by slave, used by writeLarge(). Slave answers even without request buffer,
+	// but profile must have extended frames. Limits do not change while slave runs, so read them once.
+	StatusValue readSlaveLimits(slaveInfo &sinfo, CommSlaveLimits &limits);
+
+	// Write size bytes to slave's memory in as few frames as its limits allow. If slave's request buffer holds more
+	// data than its write buffer, consecutive chunks are packed into batch frames, otherwise sent as write frames.
+	// Returns Ok or status of the first failed chunk, failedOffset receives its offset in data (size if none failed).
+	// Chunks before it are written, following ones are not sent, unless they shared batch frame with it.
+	StatusValue writeLarge(slaveInfo &sinfo, const CommSlaveLimits &limits, uint32_t memoryAddress, uint8_t *data, uint32_t size, uint32_t *failedOffset = nullptr);
+
+	// Read size bytes from slave's memory in chunks of the longest length profile allows (reads are not limited
+	// by slave's buffers). Status and failedOffset are reported as in writeLarge().
+	StatusValue readLarge(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t size, uint32_t *failedOffset = nullptr);
+
+	// Atomic read-modify-write of 8, 16 or 32 bit little endian field (T is uint8_t, uint16_t or uint32_t),
+	// executed by slave in one transaction, so no update made by slave or other masters is lost in between.
+	// Slave must have extended frames enabled. oldValue receives value of the field before the operation.
+	// Returns status of the operation (ErrMemoryOutOfRange if field is outside slave's memory) or of the frame.
+	// They are never retried: if response is lost, master cannot tell whether the operation was executed.
+
+	// field += operand (wraps around).
+	template <typename T>
+	StatusValue fetchAdd(slaveInfo &sinfo, uint32_t memoryAddress, T operand, T &oldValue);
+
+	// field = desired, if field == expected. Succeeded if oldValue == expected.
+	template <typename T>
+	StatusValue compareSwap(slaveInfo &sinfo, uint32_t memoryAddress, T expected, T desired, T &oldValue);
+
+	// field |= mask.
+	template <typename T>
+	StatusValue setBits(slaveInfo &sinfo, uint32_t memoryAddress, T mask, T &oldValue);
+
+	// field &= ~mask.
+	template <typename T>
+	StatusValue clearBits(slaveInfo &sinfo, uint32_t memoryAddress, T mask, T &oldValue);
+
+	// field = value.
+	template <typename T>
+	StatusValue swap(slaveInfo &sinfo, uint32_t memoryAddress, T value, T &oldValue);
+
+	// Get slave's status value with status frame: data length field only, answered with status byte.
 	inline StatusValue readStatus(slaveInfo &sinfo);
 
+	// Wait until slave is not Busy (its process() executed callbacks of previous writes), polling with status frames.
+	// The first delay is an estimate of Busy duration learned from previous waits (shared by all slaves), following
+	// ones double up to READY_POLL_MAX_US. Returns the last status read: Busy if timeoutUs elapsed, 0 if transfer failed.
+	// Child classes able to block until slave answers ready-wait status frame may override it.
+	virtual StatusValue waitReady(slaveInfo &sinfo, uint32_t timeoutUs);
+
+	// Read counters from slave's statistics window (see GenericSlave::enableStatisticsWindow()).
+	StatusValue readSlaveStatistics(slaveInfo &sinfo, uint32_t windowAddress, CommSlaveStatistics &statistics);
+
+#if EMBEDDEDCOMM_STATS
+	// Statistics of frames exchanged with given slave (see CommStatistics.hpp). By default all slaves share one object,
+	// child classes may override it to keep them per slave. Counters are not synchronized, so frames using
+	// the same object must not run concurrently.
+	virtual CommMasterStatistics &getStatistics(slaveInfo &sinfo);
+#endif
+
+	// Set checksum mode used in frames sent to slaves. Mode is carried in frame header,
+	// so slave answers using the same mode. Default is ChecksumCRC8. Profiles with fixed checksum ignore it.
+	void setChecksumMode(ChecksumMode mode);
+
+	// Set encoding of frame headers sent to slaves, slaves must use the same one. Default is HeaderFixed.
+	void setHeaderEncoding(HeaderEncoding encoding);
+
+	// Set policy of repeating failed transactions. Default policy makes single attempt.
+	// Failed write is repeated only after waitReady() confirms slave finished restoring its backup.
+	void setRetryPolicy(const CommRetryPolicy &policy);
+
 protected:
+	// Checksum mode used for frames sent to given slave. Override to choose mode per slave,
+	// by default mode set with setChecksumMode() is used for all slaves.
+	virtual ChecksumMode getChecksumMode(slaveInfo &sinfo);
+
+	// Header encoding used for frames sent to given slave. Override to choose encoding per slave,
+	// by default encoding set with setHeaderEncoding() is used for all slaves.
+	virtual HeaderEncoding getHeaderEncoding(slaveInfo &sinfo);
+
+	// Retry policy used for given slave. Override to choose policy per slave,
+	// by default policy set with setRetryPolicy() is used for all slaves.
+	virtual const CommRetryPolicy &getRetryPolicy(slaveInfo &sinfo);
+
+	// Monotonic time in microseconds and delay, used by waitReady(). Host builds use std::chrono, other targets
+	// should override both. Without overrides time advances only by requested delays, so slave is polled back to back.
+	virtual uint64_t getTimeUs();
+	virtual void sleepUs(uint32_t delayUs);
+
 	// Some hardware-specific function used to write bytes to slave.
 	virtual int writeBytes(slaveInfo &sinfo, uint8_t *bytes, uint32_t numberOfBytes) = 0;
 
 	// Some hardware-specific function used to read bytes from slave.
 	virtual int readBytes(slaveInfo &sinfo, uint8_t *bytes, uint32_t numberOfBytes) = 0;
+
+	// Write segments to slave as one continuous stream of bytes (frame header, caller's data and checksum
+	// are passed separately, so data does not need to be copied). Default implementation gathers segments
+	// into temporary buffer and calls writeBytes(), override if hardware can send segments directly.
+	virtual int writeBytesV(slaveInfo &sinfo, const CommSegment *segments, uint32_t numberOfSegments);
+
+	// Frame building blocks, shared by blocking transfers and child classes implementing their own (eg. asynchronous) ones.
+
+	// Fill frame header (data length with flags, memory address). Returns checksum (not finalized) of the header.
+	static uint32_t buildHeader(ChecksumMode mode, uint8_t *header, uint32_t memoryAddress, uint32_t dataLength, bool read);
+
+	// Fill header of extended frame carrying request of requestSize bytes, to which slave answers with responseSize bytes.
+	// Returns checksum (not finalized) of the header.
+	static uint32_t buildExtendedHeader(ChecksumMode mode, uint8_t *header, ExtendedOpcode opcode, uint32_t requestSize, uint32_t responseSize);
+
+	// Fill varint encoded header, headerSize receives its length (up to MAX_VARINT_HEADER_SIZE).
+	// For extended frames addressField carries opcode and response size. Returns checksum (not finalized) of the header.
+	static uint32_t buildVarintHeader(ChecksumMode mode, uint8_t *header, uint32_t &headerSize, uint32_t addressField, uint32_t dataLength, bool read, bool extended);
+
+	// Fill header in encoding used with given slave, headerSize receives its length (up to MAX_HEADER_SIZE).
+	// For extended frames addressField carries opcode and response size. Returns checksum (not finalized) of the header.
+	uint32_t buildFrameHeader(slaveInfo &sinfo, ChecksumMode mode, uint8_t *header, uint32_t &headerSize, uint32_t addressField, uint32_t dataLength, bool read, bool extended = false);
+
+	// Fill status frame (data length field only) in encoding used with given slave, length is STATUS_FRAME_LENGTH
+	// or READY_FRAME_LENGTH. Returns size of the frame (up to MAX_VARINT_SIZE).
+	uint32_t buildStatusFrame(slaveInfo &sinfo, uint8_t *frame, uint32_t length);
+
+	// Calculate checksum of write frame over header and data, store it (little endian) in checksumBuffer.
+	static void buildWriteChecksum(ChecksumMode mode, uint32_t headerChecksum, const uint8_t *data, uint32_t writeSize, uint8_t *checksumBuffer);
+
+	// Check response to read frame, tail holds checksum followed by status byte.
+	// Returns status sent by slave, or ErrDataCorrupted if checksum does not match.
+	static StatusValue checkReadResponse(ChecksumMode mode, uint32_t headerChecksum, const uint8_t *data, uint32_t readSize, const uint8_t *tail);
+
+	static constexpr uint32_t READY_POLL_MIN_US = 20; // Shortest delay between status frames sent by waitReady().
+	static constexpr uint32_t READY_POLL_MAX_US = 5000; // Longest one.
+
+private:
+	// Checksum mode of frame sent to given slave, fixed by profile or chosen by getChecksumMode().
+	ChecksumMode frameChecksumMode(slaveInfo &sinfo);
+
+	// Send extended frame with request gathered from segments and receive response of responseSize bytes.
+	// Segment 0 is filled with frame header and one segment after the last one with checksum.
+	// Response buffer must have space for checksum and status. Returns status of the frame.
+	StatusValue transferExtended(slaveInfo &sinfo, ExtendedOpcode opcode, CommSegment *segments, uint32_t numberOfSegments, uint8_t *response, uint32_t responseSize);
+
+	// Execute batch of reads, returns status of the frame or first failed read.
+	StatusValue executeReads(slaveInfo &sinfo, CommBatch &batch);
+
+	template <typename T>
+	StatusValue executeAtomic(slaveInfo &sinfo, AtomicOperation operation, uint32_t memoryAddress, T operand, T desired, T &oldValue);
+
+	// Single attempt of public transactions with the same names.
+	StatusValue writeFrame(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize);
+	StatusValue readFrame(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize);
+	StatusValue executeFrame(slaveInfo &sinfo, CommBatch &batch);
+	StatusValue readStreamFrame(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *buffer, uint32_t size, uint32_t &count, uint8_t &sequence);
+
+	// Run transaction of large transfer. If slave is Busy after previous one (its process() did not run yet),
+	// transaction is rejected, so it is repeated once slave is ready.
+	template <typename Transaction>
+	StatusValue transferChunk(slaveInfo &sinfo, Transaction transaction);
+
+	// Status byte is not covered by checksum. Slave never sends Ok together with other flags,
+	// so such value is a corrupted status byte and is reported as ErrDataCorrupted.
+	static inline StatusValue checkStatusByte(StatusValue status);
+
+	// Run transaction (callable returning StatusValue) until it succeeds or retry policy gives up.
+	// Before repeating write (writesMemory), wait for slave to become ready.
+	template <typename Transaction>
+	StatusValue retry(slaveInfo &sinfo, bool writesMemory, uint32_t *attempts, Transaction transaction);
+
+	// Start time of frame, taken only if statistics are enabled.
+	inline uint64_t frameStart();
+
+	// Account frame in statistics of slave (if enabled), returns its status.
+	inline StatusValue frameDone(slaveInfo &sinfo, uint64_t start, uint32_t bytesOut, uint32_t bytesIn, StatusValue status);
+
+	ChecksumMode checksumMode;
+	HeaderEncoding headerEncoding;
+	CommRetryPolicy retryPolicy;
+	uint32_t busyEstimateUs; // Moving average of Busy duration observed by waitReady().
+	uint64_t sleptUs; // Time source of targets which do not override getTimeUs().
+#if EMBEDDEDCOMM_STATS
+	CommMasterStatistics statistics;
+#endif
 };
 
-template <typename slaveInfo>
-GenericMaster<slaveInfo>::GenericMaster() {}
+template <typename slaveInfo, typename Profile>
+GenericMaster<slaveInfo, Profile>::GenericMaster():
+	checksumMode(Profile::CHECKSUM_MODE),
+	headerEncoding(HeaderFixed),
+	busyEstimateUs(READY_POLL_MIN_US),
+	sleptUs(0)
+{}
 
-template <typename slaveInfo>
-StatusValue GenericMaster<slaveInfo>::write(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize) {
-	// four bytes for data length + four bytes for address + writeSize bytes for data + one byte for checksum.
-	const uint32_t messageBufferSize = writeSize + SLAVE_ADDRESS_SIZE * 2 + CHECKSUM_SIZE;
-	uint8_t messageBuffer[messageBufferSize];
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::setChecksumMode(ChecksumMode mode) {
+	checksumMode = mode;
+}
 
-	// Data length
-	writeSize &= ~(1 << 31); // Ensure msb is cleared (read flag).
-	memcpy(messageBuffer, &writeSize, SLAVE_ADDRESS_SIZE);
+template <typename slaveInfo, typename Profile>
+ChecksumMode GenericMaster<slaveInfo, Profile>::getChecksumMode(slaveInfo &sinfo) {
+	return checksumMode;
+}
 
-	// Memory address
-	memcpy(messageBuffer + SLAVE_ADDRESS_SIZE, &memoryAddress, SLAVE_ADDRESS_SIZE);
-	
-	// Data
-	if (data != NULL) {
-		memcpy(&messageBuffer[SLAVE_ADDRESS_SIZE*2], data, writeSize);
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::setHeaderEncoding(HeaderEncoding encoding) {
+	headerEncoding = encoding;
+}
+
+template <typename slaveInfo, typename Profile>
+HeaderEncoding GenericMaster<slaveInfo, Profile>::getHeaderEncoding(slaveInfo &sinfo) {
+	return headerEncoding;
+}
+
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::setRetryPolicy(const CommRetryPolicy &policy) {
+	retryPolicy = policy;
+}
+
+template <typename slaveInfo, typename Profile>
+const CommRetryPolicy &GenericMaster<slaveInfo, Profile>::getRetryPolicy(slaveInfo &sinfo) {
+	return retryPolicy;
+}
+
+template <typename slaveInfo, typename Profile>
+ChecksumMode GenericMaster<slaveInfo, Profile>::frameChecksumMode(slaveInfo &sinfo) {
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		return getChecksumMode(sinfo);
+	} else {
+		return Profile::CHECKSUM_MODE;
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::write(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize, uint32_t *attempts) {
+	return retry(sinfo, true, attempts, [&]() {
+		return writeFrame(sinfo, memoryAddress, data, writeSize);
+	});
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::writeFrame(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize) {
+	const ChecksumMode mode = frameChecksumMode(sinfo);
+
+	if (data == NULL) {
+		writeSize = 0;
 	}
 
-	// Attach checksum.
-	messageBuffer[messageBufferSize - 1] = calculateChecksum(messageBuffer, messageBufferSize-1);
+	// Access which cannot be expressed with profile's header fields is not sent at all.
+	if ( (writeSize > Profile::DATA_LENGTH_MASK) || (memoryAddress > Profile::MAX_ADDRESS) ) {
+		return ErrMemoryOutOfRange;
+	}
+
+	const uint64_t start = frameStart();
+	uint8_t header[MAX_HEADER_SIZE];
+	uint32_t headerSize;
+	uint32_t checksum = buildFrameHeader(sinfo, mode, header, headerSize, memoryAddress, writeSize, false);
+	const uint32_t frameSize = headerSize + writeSize + checksumSize(mode);
+
+	// Checksum is calculated over header and caller's buffer.
+	uint8_t checksumBuffer[MAX_CHECKSUM_SIZE];
+	buildWriteChecksum(mode, checksum, data, writeSize, checksumBuffer);
 
-	if (writeBytes(sinfo, messageBuffer, messageBufferSize) < 0) {
-		return 0;
+	const CommSegment segments[] = {
+		{header, headerSize},
+		{data, writeSize},
+		{checksumBuffer, checksumSize(mode)}
+	};
+
+	if (writeBytesV(sinfo, segments, 3) < 0) {
+		return frameDone(sinfo, start, frameSize, 0, 0);
 	}
 
 	StatusValue status;
 	if (readBytes(sinfo, &status, 1) < 0) {
-		return 0;
+		return frameDone(sinfo, start, frameSize, 0, 0);
 	}
 
-	return status;
+	return frameDone(sinfo, start, frameSize, 1, status);
 }
 
-template <typename slaveInfo>
-StatusValue GenericMaster<slaveInfo>::read(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize) {
-	const uint32_t messageBufferSize = SLAVE_ADDRESS_SIZE * 2;
-	uint8_t messageBuffer[messageBufferSize];
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::read(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize, uint32_t *attempts) {
+	return retry(sinfo, false, attempts, [&]() {
+		return readFrame(sinfo, memoryAddress, buffer, readSize);
+	});
+}
 
-	readSize |= (1 << 31); // Set read flag.
-	memcpy(messageBuffer, &readSize, SLAVE_ADDRESS_SIZE);
-	readSize &= ~(1 << 31); // Clear to store read size only.
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readFrame(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize) {
+	const ChecksumMode mode = frameChecksumMode(sinfo);
+
+	if ( (readSize > Profile::DATA_LENGTH_MASK) || (memoryAddress > Profile::MAX_ADDRESS) ) {
+		return ErrMemoryOutOfRange;
+	}
 
-	memcpy(messageBuffer + SLAVE_ADDRESS_SIZE, &memoryAddress, SLAVE_ADDRESS_SIZE);
+	const uint64_t start = frameStart();
+	uint8_t header[MAX_HEADER_SIZE];
+	uint32_t headerSize;
+	uint32_t checksum = buildFrameHeader(sinfo, mode, header, headerSize, memoryAddress, readSize, true);
+	const uint32_t responseSize = readSize + checksumSize(mode) + 1;
 
-	if (writeBytes(sinfo, messageBuffer, messageBufferSize) < 0) {
-		return 0;
+	if (writeBytes(sinfo, header, headerSize) < 0) {
+		return frameDone(sinfo, start, headerSize, 0, 0);
 	} 
 
 	// Read data from slave into read buffer
 	if (readBytes(sinfo, buffer, readSize) < 0) {
-		return 0;
+		return frameDone(sinfo, start, headerSize, 0, 0);
 	}
 
-	uint8_t buff[2];
-	// Read data from slave into read buffer
-	if (readBytes(sinfo, buff, 2) < 0) {
-		return 0;
+	// Checksum followed by status byte.
+	uint8_t tail[MAX_CHECKSUM_SIZE + 1];
+	if (readBytes(sinfo, tail, checksumSize(mode) + 1) < 0) {
+		return frameDone(sinfo, start, headerSize, 0, 0);
+	}
+
+	return frameDone(sinfo, start, headerSize, responseSize, checkReadResponse(mode, checksum, buffer, readSize, tail));
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readStream(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *buffer, uint32_t size, uint32_t &count, uint8_t &sequence, uint32_t *attempts) {
+	// Sequence advances only after successful attempt, so repeated one asks for the same bytes.
+	return retry(sinfo, false, attempts, [&]() {
+		return readStreamFrame(sinfo, windowAddress, buffer, size, count, sequence);
+	});
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readStreamFrame(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *buffer, uint32_t size, uint32_t &count, uint8_t &sequence) {
+	const ChecksumMode mode = frameChecksumMode(sinfo);
+	const uint32_t address = windowAddress + (sequence & 1);
+
+	count = 0;
+	size = (size < MAX_STREAM_READ_SIZE) ? size : MAX_STREAM_READ_SIZE;
+
+	if ( (size + STREAM_COUNT_SIZE > Profile::DATA_LENGTH_MASK) || (address > Profile::MAX_ADDRESS) ) {
+		return ErrMemoryOutOfRange;
+	}
+
+	const uint64_t start = frameStart();
+	uint8_t header[MAX_HEADER_SIZE];
+	uint32_t headerSize;
+	uint32_t checksum = buildFrameHeader(sinfo, mode, header, headerSize, address, size + STREAM_COUNT_SIZE, true);
+	const uint32_t responseSize = STREAM_COUNT_SIZE + size + checksumSize(mode) + 1;
+
+	if (writeBytes(sinfo, header, headerSize) < 0) {
+		return frameDone(sinfo, start, headerSize, 0, 0);
+	}
+
+	// Number of stream bytes, stream bytes padded to requested size, checksum and status.
+	uint8_t countBytes[STREAM_COUNT_SIZE];
+	uint8_t tail[MAX_CHECKSUM_SIZE + 1];
+	if ( (readBytes(sinfo, countBytes, STREAM_COUNT_SIZE) < 0) || (readBytes(sinfo, buffer, size) < 0) ||
+		(readBytes(sinfo, tail, checksumSize(mode) + 1) < 0) ) {
+		return frameDone(sinfo, start, headerSize, 0, 0);
+	}
+
+	checksum = checksumUpdate(mode, checksum, countBytes, STREAM_COUNT_SIZE);
+	StatusValue status = checkReadResponse(mode, checksum, buffer, size, tail);
+
+	uint16_t streamCount;
+	memcpy(&streamCount, countBytes, sizeof(streamCount));
+	if ( (status == Ok) && (streamCount > size) ) {
+		status = ErrDataCorrupted;
+	}
+
+	if (status == Ok) {
+		count = streamCount;
+		sequence ^= 1;
+	}
+
+	return frameDone(sinfo, start, headerSize, responseSize, status);
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::writeStream(slaveInfo &sinfo, uint32_t windowAddress, uint8_t *data, uint32_t size, uint8_t &sequence, uint32_t *attempts) {
+	StatusValue status = write(sinfo, windowAddress + (sequence & 1), data, size, attempts);
+	if (status == Ok) {
+		sequence ^= 1;
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::execute(slaveInfo &sinfo, CommBatch &batch, uint32_t *attempts) {
+	// Slave executes batch only after verifying its checksum. Operations are reads and writes, repeating them is harmless.
+	return retry(sinfo, false, attempts, [&]() {
+		return executeFrame(sinfo, batch);
+	});
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::executeFrame(slaveInfo &sinfo, CommBatch &batch) {
+	if (batch.size() == 0) {
+		return Ok;
+	}
+
+	const uint32_t responseSize = batch.getResponseSize();
+
+	// Segment 0 is reserved for frame header, entry headers are interleaved with write data, sent without copying.
+	CommSegment segments[MAX_BATCH_ENTRIES*2 + 2];
+	uint32_t numberOfSegments = 1;
+
+	for (uint32_t i = 0; i < batch.size(); i++) {
+		CommBatchEntry &entry = batch.entry(i);
+
+		segments[numberOfSegments++] = {entry.header, BATCH_ENTRY_HEADER_SIZE};
+
+		if ( (entry.operation == BatchWrite) && (entry.length > 0) ) {
+			segments[numberOfSegments++] = {entry.data, entry.length};
+		}
+	}
+
+	uint8_t response[responseSize + MAX_CHECKSUM_SIZE + 1];
+	StatusValue status = transferExtended(sinfo, OpBatch, segments, numberOfSegments, response, responseSize);
+	if (status != Ok) {
+		batch.setStatus(status);
+		return status;
+	}
+
+	// Every entry is answered with status byte, reads are followed by data.
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < batch.size(); i++) {
+		CommBatchEntry &entry = batch.entry(i);
+
+		entry.status = response[offset++];
+
+		if (entry.operation == BatchRead) {
+			if (entry.length > 0) {
+				memcpy(entry.data, &response[offset], entry.length);
+			}
+			offset += entry.length;
+		}
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readDirtyMap(slaveInfo &sinfo, uint32_t firstPage, uint32_t numberOfPages, uint8_t *bitmap) {
+	const uint32_t mapSize = numberOfPages / 8 + ((numberOfPages % 8) ? 1 : 0);
+	if ( (numberOfPages == 0) || (mapSize > Profile::MAX_EXTENDED_RESPONSE_SIZE) ) {
+		return ErrInvalidRequest;
+	}
+
+	uint8_t request[DIRTY_MAP_REQUEST_SIZE];
+	memcpy(&request[0], &firstPage, sizeof(firstPage));
+	memcpy(&request[4], &numberOfPages, sizeof(numberOfPages));
+	CommSegment segments[3] = {{}, {request, DIRTY_MAP_REQUEST_SIZE}};
+
+	uint8_t response[mapSize + MAX_CHECKSUM_SIZE + 1];
+	StatusValue status = transferExtended(sinfo, OpDirtyMap, segments, 2, response, mapSize);
+	if (status == Ok) {
+		memcpy(bitmap, response, mapSize);
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readDirtyPages(slaveInfo &sinfo, uint32_t memoryAddress, uint32_t length, uint32_t pageSize, uint8_t *buffer) {
+	if ( (length == 0) || (pageSize == 0) || (memoryAddress % pageSize != 0) ) {
+		return ErrInvalidRequest;
+	}
+
+	const uint32_t numberOfPages = length / pageSize + ((length % pageSize) ? 1 : 0);
+	uint8_t bitmap[numberOfPages / 8 + 1];
+
+	StatusValue status = readDirtyMap(sinfo, memoryAddress / pageSize, numberOfPages, bitmap);
+	if (status != Ok) {
+		return status;
+	}
+
+	// Runs of dirty pages are read as single entries, limited by batch response size.
+	const uint32_t maxResponse = (Profile::MAX_EXTENDED_RESPONSE_SIZE < MAX_BATCH_RESPONSE_SIZE) ? Profile::MAX_EXTENDED_RESPONSE_SIZE : MAX_BATCH_RESPONSE_SIZE;
+	const uint32_t maxRead = ((maxResponse - 1) < UINT16_MAX) ? (maxResponse - 1) : UINT16_MAX;
+	CommBatch batch;
+
+	uint32_t page = 0;
+	while (page < numberOfPages) {
+		if ( !(bitmap[page / 8] & (1u << (page % 8))) ) {
+			page++;
+			continue;
+		}
+
+		uint32_t runEnd = page + 1;
+		while ( (runEnd < numberOfPages) && (bitmap[runEnd / 8] & (1u << (runEnd % 8))) ) {
+			runEnd++;
+		}
+
+		uint32_t offset = page * pageSize;
+		const uint32_t end = (runEnd * pageSize < length) ? runEnd * pageSize : length;
+
+		while (offset < end) {
+			const uint32_t n = (end - offset < maxRead) ? (end - offset) : maxRead;
+
+			if ( (batch.getResponseSize() + 1 + n > maxResponse) || (!batch.read(memoryAddress + offset, &buffer[offset], n)) ) {
+				status = executeReads(sinfo, batch);
+				if (status != Ok) {
+					return status;
+				}
+				batch.clear();
+				continue;
+			}
+
+			offset += n;
+		}
+
+		page = runEnd;
+	}
+
+	return executeReads(sinfo, batch);
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::executeReads(slaveInfo &sinfo, CommBatch &batch) {
+	StatusValue status = execute(sinfo, batch);
+	if (status != Ok) {
+		return status;
+	}
+
+	for (uint32_t i = 0; i < batch.size(); i++) {
+		if (batch.getStatus(i) != Ok) {
+			return batch.getStatus(i);
+		}
+	}
+
+	return Ok;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readSlaveLimits(slaveInfo &sinfo, CommSlaveLimits &limits) {
+	uint8_t response[SLAVE_LIMITS_SIZE + MAX_CHECKSUM_SIZE + 1];
+
+	// Request has no data, segments hold only frame header and checksum.
+	StatusValue status = retry(sinfo, false, nullptr, [&]() {
+		CommSegment segments[2] = {};
+		return transferExtended(sinfo, OpLimits, segments, 1, response, SLAVE_LIMITS_SIZE);
+	});
+	if (status == Ok) {
+		memcpy(&limits.memorySize, &response[0], sizeof(uint32_t));
+		memcpy(&limits.maxWriteSize, &response[4], sizeof(uint32_t));
+		memcpy(&limits.requestBufferSize, &response[8], sizeof(uint32_t));
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::writeLarge(slaveInfo &sinfo, const CommSlaveLimits &limits, uint32_t memoryAddress, uint8_t *data, uint32_t size, uint32_t *failedOffset) {
+	uint32_t offset = 0;
+	StatusValue status = Ok;
+
+	// Write frame carries up to maxWriteSize bytes, batch frame its request buffer minus entry headers.
+	const uint32_t maxWrite = (limits.maxWriteSize < Profile::DATA_LENGTH_MASK) ? limits.maxWriteSize : Profile::DATA_LENGTH_MASK;
+	const uint32_t maxRequest = (limits.requestBufferSize < Profile::DATA_LENGTH_MASK) ? limits.requestBufferSize : Profile::DATA_LENGTH_MASK;
+	const bool batched = (Profile::MAX_EXTENDED_RESPONSE_SIZE > 0) && (maxRequest > BATCH_ENTRY_HEADER_SIZE + maxWrite);
+
+	if ( (size > 0) && (data == nullptr) ) {
+		status = ErrInvalidRequest;
+	} else if ( (size > 0) && (maxWrite == 0) && (!batched) ) {
+		status = ErrBackupBufferOverflow;
+	}
+
+	while ( (status == Ok) && (offset < size) && (!batched) ) {
+		const uint32_t n = (size - offset < maxWrite) ? (size - offset) : maxWrite;
+
+		status = transferChunk(sinfo, [&]() {
+			return write(sinfo, memoryAddress + offset, &data[offset], n);
+		});
+
+		if (status == Ok) {
+			offset += n;
+		}
+	}
+
+	CommBatch batch;
+	while ( (status == Ok) && (offset < size) && batched ) {
+		// Fill batch with chunks as long as they fit into request buffer.
+		uint32_t end = offset;
+		while (end < size) {
+			const uint32_t room = maxRequest - batch.getRequestSize();
+			if (room <= BATCH_ENTRY_HEADER_SIZE) {
+				break;
+			}
+
+			uint32_t n = room - BATCH_ENTRY_HEADER_SIZE;
+			n = (n < UINT16_MAX) ? n : UINT16_MAX;
+			n = (size - end < n) ? (size - end) : n;
+
+			if (!batch.write(memoryAddress + end, &data[end], n)) {
+				break;
+			}
+			end += n;
+		}
+
+		status = transferChunk(sinfo, [&]() {
+			return execute(sinfo, batch);
+		});
+
+		// Entries are executed in order, report the first one which failed.
+		for (uint32_t i = 0; i < batch.size(); i++) {
+			if (batch.getStatus(i) != Ok) {
+				status = batch.getStatus(i);
+				break;
+			}
+			offset += batch.entry(i).length;
+		}
+
+		batch.clear();
+	}
+
+	if (failedOffset != nullptr) {
+		*failedOffset = offset;
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readLarge(slaveInfo &sinfo, uint32_t memoryAddress, uint8_t *buffer, uint32_t size, uint32_t *failedOffset) {
+	uint32_t offset = 0;
+	StatusValue status = Ok;
+
+	while ( (status == Ok) && (offset < size) ) {
+		const uint32_t n = (size - offset < Profile::DATA_LENGTH_MASK) ? (size - offset) : Profile::DATA_LENGTH_MASK;
+
+		status = transferChunk(sinfo, [&]() {
+			return read(sinfo, memoryAddress + offset, &buffer[offset], n);
+		});
+
+		if (status == Ok) {
+			offset += n;
+		}
+	}
+
+	if (failedOffset != nullptr) {
+		*failedOffset = offset;
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename Transaction>
+StatusValue GenericMaster<slaveInfo, Profile>::transferChunk(slaveInfo &sinfo, Transaction transaction) {
+	StatusValue status = transaction();
+	if (status != Busy) {
+		return status;
+	}
+
+	const StatusValue ready = waitReady(sinfo, getRetryPolicy(sinfo).readyTimeoutUs);
+	if ( (ready == NotUsed) || (ready & Busy) ) {
+		return status;
+	}
+
+	return transaction();
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::fetchAdd(slaveInfo &sinfo, uint32_t memoryAddress, T operand, T &oldValue) {
+	return executeAtomic(sinfo, AtomicFetchAdd, memoryAddress, operand, (T)0, oldValue);
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::compareSwap(slaveInfo &sinfo, uint32_t memoryAddress, T expected, T desired, T &oldValue) {
+	return executeAtomic(sinfo, AtomicCompareSwap, memoryAddress, expected, desired, oldValue);
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::setBits(slaveInfo &sinfo, uint32_t memoryAddress, T mask, T &oldValue) {
+	return executeAtomic(sinfo, AtomicSetBits, memoryAddress, mask, (T)0, oldValue);
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::clearBits(slaveInfo &sinfo, uint32_t memoryAddress, T mask, T &oldValue) {
+	return executeAtomic(sinfo, AtomicClearBits, memoryAddress, mask, (T)0, oldValue);
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::swap(slaveInfo &sinfo, uint32_t memoryAddress, T value, T &oldValue) {
+	return executeAtomic(sinfo, AtomicSwap, memoryAddress, value, (T)0, oldValue);
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename T>
+StatusValue GenericMaster<slaveInfo, Profile>::executeAtomic(slaveInfo &sinfo, AtomicOperation operation, uint32_t memoryAddress, T operand, T desired, T &oldValue) {
+	static_assert( std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value || std::is_same<T, uint32_t>::value,
+		"atomic operations work on uint8_t, uint16_t and uint32_t fields");
+
+	// Fields are little endian, as is every supported target.
+	uint8_t request[MAX_ATOMIC_REQUEST_SIZE];
+	request[0] = operation;
+	request[1] = sizeof(T);
+	memcpy(&request[2], &memoryAddress, sizeof(memoryAddress));
+	memcpy(&request[ATOMIC_REQUEST_HEADER_SIZE], &operand, sizeof(T));
+	if (operation == AtomicCompareSwap) {
+		memcpy(&request[ATOMIC_REQUEST_HEADER_SIZE + sizeof(T)], &desired, sizeof(T));
+	}
+
+	const uint32_t requestSize = ATOMIC_REQUEST_HEADER_SIZE + sizeof(T) * ((operation == AtomicCompareSwap) ? 2 : 1);
+	CommSegment segments[3] = {{}, {request, requestSize}};
+
+	// Status of operation followed by old value.
+	uint8_t response[1 + sizeof(T) + MAX_CHECKSUM_SIZE + 1];
+	StatusValue status = transferExtended(sinfo, OpAtomic, segments, 2, response, 1 + sizeof(T));
+	if (status != Ok) {
+		return status;
+	}
+
+	memcpy(&oldValue, &response[1], sizeof(T));
+	return response[0];
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::transferExtended(slaveInfo &sinfo, ExtendedOpcode opcode, CommSegment *segments, uint32_t numberOfSegments, uint8_t *response, uint32_t responseSize) {
+	const ChecksumMode mode = frameChecksumMode(sinfo);
+
+	uint32_t requestSize = 0;
+	for (uint32_t i = 1; i < numberOfSegments; i++) {
+		requestSize += segments[i].size;
 	}
 
-	uint8_t receivedChecksum = buff[0];
-	StatusValue status = (StatusValue)buff[1];
+	if ( (requestSize > Profile::DATA_LENGTH_MASK) || (responseSize > Profile::MAX_EXTENDED_RESPONSE_SIZE) ) {
+		return ErrInvalidRequest;
+	}
+
+	const uint64_t start = frameStart();
+	uint8_t header[MAX_HEADER_SIZE];
+	uint32_t headerSize;
+	uint32_t opcodeField = opcode | (responseSize << EXTENDED_RESPONSE_SHIFT);
+	uint32_t checksum = buildFrameHeader(sinfo, mode, header, headerSize, opcodeField, requestSize, false, true);
+	segments[0] = {header, headerSize};
+
+	for (uint32_t i = 1; i < numberOfSegments; i++) {
+		checksum = checksumUpdate(mode, checksum, segments[i].data, segments[i].size);
+	}
+
+	// Slave continues checksum of the request over its response, so only a copy is finalized here.
+	uint8_t checksumBuffer[MAX_CHECKSUM_SIZE];
+	uint32_t requestChecksum = checksumFinalize(mode, checksum);
+	memcpy(checksumBuffer, &requestChecksum, checksumSize(mode));
+	segments[numberOfSegments++] = {checksumBuffer, checksumSize(mode)};
+
+	const uint32_t frameSize = headerSize + requestSize + checksumSize(mode);
+
+	if (writeBytesV(sinfo, segments, numberOfSegments) < 0) {
+		return frameDone(sinfo, start, frameSize, 0, 0);
+	}
+
+	// Response, checksum and status are read at once.
+	if (readBytes(sinfo, response, responseSize + checksumSize(mode) + 1) < 0) {
+		return frameDone(sinfo, start, frameSize, 0, 0);
+	}
+
+	return frameDone(sinfo, start, frameSize, responseSize + checksumSize(mode) + 1,
+		checkReadResponse(mode, checksum, response, responseSize, &response[responseSize]));
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t GenericMaster<slaveInfo, Profile>::buildExtendedHeader(ChecksumMode mode, uint8_t *header, ExtendedOpcode opcode, uint32_t requestSize, uint32_t responseSize) {
+	uint32_t lengthField = (requestSize & Profile::DATA_LENGTH_MASK) | Profile::EXTENDED_FLAG;
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		lengthField |= (uint32_t)mode << Profile::CHECKSUM_MODE_SHIFT;
+	}
+	uint32_t opcodeField = opcode | ((responseSize & Profile::MAX_EXTENDED_RESPONSE_SIZE) << EXTENDED_RESPONSE_SHIFT);
+
+	// Fields are little endian, narrower profiles take the lower bytes.
+	memcpy(header, &lengthField, Profile::LENGTH_SIZE);
+	memcpy(header + Profile::LENGTH_SIZE, &opcodeField, Profile::ADDRESS_SIZE);
+
+	return checksumUpdate(mode, checksumInit(mode), header, Profile::HEADER_SIZE);
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t GenericMaster<slaveInfo, Profile>::buildHeader(ChecksumMode mode, uint8_t *header, uint32_t memoryAddress, uint32_t dataLength, bool read) {
+	uint32_t lengthField = dataLength & Profile::DATA_LENGTH_MASK;
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		lengthField |= (uint32_t)mode << Profile::CHECKSUM_MODE_SHIFT;
+	}
+	if (read) {
+		lengthField |= Profile::READ_FLAG;
+	}
+
+	// Fields are little endian, narrower profiles take the lower bytes.
+	memcpy(header, &lengthField, Profile::LENGTH_SIZE);
+	memcpy(header + Profile::LENGTH_SIZE, &memoryAddress, Profile::ADDRESS_SIZE);
+
+	return checksumUpdate(mode, checksumInit(mode), header, Profile::HEADER_SIZE);
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t GenericMaster<slaveInfo, Profile>::buildVarintHeader(ChecksumMode mode, uint8_t *header, uint32_t &headerSize, uint32_t addressField, uint32_t dataLength, bool read, bool extended) {
+	uint32_t flags = (read ? VARINT_READ_FLAG : 0) | (extended ? VARINT_EXTENDED_FLAG : 0);
+	uint32_t flagBits = VARINT_CHECKSUM_MODE_SHIFT;
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		flags |= (uint32_t)mode << VARINT_CHECKSUM_MODE_SHIFT;
+		flagBits += 2;
+	}
+
+	const uint32_t fields[] = {((dataLength & Profile::DATA_LENGTH_MASK) << flagBits) | flags, addressField};
+
+	headerSize = 0;
+	for (uint32_t value : fields) {
+		while (value >= 0x80) {
+			header[headerSize++] = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		header[headerSize++] = (uint8_t)value;
+	}
+
+	return checksumUpdate(mode, checksumInit(mode), header, headerSize);
+}
 
-	uint8_t checksum = calculateChecksum(messageBuffer, messageBufferSize);
-	if (calculateChecksumAppend(buffer, readSize, checksum) != receivedChecksum) {
+template <typename slaveInfo, typename Profile>
+uint32_t GenericMaster<slaveInfo, Profile>::buildFrameHeader(slaveInfo &sinfo, ChecksumMode mode, uint8_t *header, uint32_t &headerSize, uint32_t addressField, uint32_t dataLength, bool read, bool extended) {
+	if (getHeaderEncoding(sinfo) == HeaderVarint) {
+		return buildVarintHeader(mode, header, headerSize, addressField, dataLength, read, extended);
+	}
+
+	headerSize = Profile::HEADER_SIZE;
+	if (extended) {
+		return buildExtendedHeader(mode, header, (ExtendedOpcode)(addressField & EXTENDED_OPCODE_MASK), dataLength, addressField >> EXTENDED_RESPONSE_SHIFT);
+	}
+	return buildHeader(mode, header, addressField, dataLength, read);
+}
+
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::buildWriteChecksum(ChecksumMode mode, uint32_t headerChecksum, const uint8_t *data, uint32_t writeSize, uint8_t *checksumBuffer) {
+	uint32_t checksum = checksumFinalize(mode, checksumUpdate(mode, headerChecksum, data, writeSize));
+	memcpy(checksumBuffer, &checksum, checksumSize(mode));
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::checkReadResponse(ChecksumMode mode, uint32_t headerChecksum, const uint8_t *data, uint32_t readSize, const uint8_t *tail) {
+	const uint32_t checksumBytes = checksumSize(mode);
+
+	uint32_t receivedChecksum = 0;
+	memcpy(&receivedChecksum, tail, checksumBytes);
+
+	uint32_t checksum = checksumUpdate(mode, headerChecksum, data, readSize);
+	if (checksumFinalize(mode, checksum) != receivedChecksum) {
 		return ErrDataCorrupted;
 	}
 
+	return (StatusValue)tail[checksumBytes];
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t GenericMaster<slaveInfo, Profile>::buildStatusFrame(slaveInfo &sinfo, uint8_t *frame, uint32_t length) {
+	const ChecksumMode mode = frameChecksumMode(sinfo);
+
+	if (getHeaderEncoding(sinfo) == HeaderVarint) {
+		uint32_t value = VARINT_READ_FLAG | VARINT_EXTENDED_FLAG;
+		uint32_t flagBits = VARINT_CHECKSUM_MODE_SHIFT;
+		if constexpr (Profile::CHECKSUM_IN_HEADER) {
+			value |= (uint32_t)mode << VARINT_CHECKSUM_MODE_SHIFT;
+			flagBits += 2;
+		}
+		value |= length << flagBits;
+
+		uint32_t frameSize = 0;
+		while (value >= 0x80) {
+			frame[frameSize++] = (uint8_t)(value | 0x80);
+			value >>= 7;
+		}
+		frame[frameSize++] = (uint8_t)value;
+		return frameSize;
+	}
+
+	uint32_t lengthField = length | Profile::READ_FLAG | Profile::EXTENDED_FLAG;
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		lengthField |= (uint32_t)mode << Profile::CHECKSUM_MODE_SHIFT;
+	}
+
+	memcpy(frame, &lengthField, Profile::LENGTH_SIZE);
+	return Profile::LENGTH_SIZE;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readStatus(slaveInfo &sinfo) {
+	const uint64_t start = frameStart();
+	uint8_t frame[MAX_VARINT_SIZE];
+	const uint32_t frameSize = buildStatusFrame(sinfo, frame, STATUS_FRAME_LENGTH);
+
+	if (writeBytes(sinfo, frame, frameSize) < 0) {
+		return frameDone(sinfo, start, frameSize, 0, 0);
+	}
+
+	StatusValue status;
+	if (readBytes(sinfo, &status, 1) < 0) {
+		return frameDone(sinfo, start, frameSize, 0, 0);
+	}
+
+	return frameDone(sinfo, start, frameSize, 1, status);
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::readSlaveStatistics(slaveInfo &sinfo, uint32_t windowAddress, CommSlaveStatistics &statistics) {
+	uint8_t buffer[sizeof(CommSlaveStatistics)];
+
+	StatusValue status = read(sinfo, windowAddress, buffer, sizeof(buffer));
+	if (status == Ok) {
+		memcpy(&statistics, buffer, sizeof(buffer));
+	}
+
 	return status;
 }
 
-template <typename slaveInfo>
-StatusValue GenericMaster<slaveInfo>::readStatus(slaveInfo &sinfo) {
-	uint8_t dummy;
-	return read(sinfo, 0, &dummy, 1);
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::checkStatusByte(StatusValue status) {
+	if ( (status & Ok) && (status != Ok) ) {
+		return ErrDataCorrupted;
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+template <typename Transaction>
+StatusValue GenericMaster<slaveInfo, Profile>::retry(slaveInfo &sinfo, bool writesMemory, uint32_t *attempts, Transaction transaction) {
+	const CommRetryPolicy &policy = getRetryPolicy(sinfo);
+	uint32_t delayUs = (policy.initialDelayUs < policy.maxDelayUs) ? policy.initialDelayUs : policy.maxDelayUs;
+	uint32_t attempt = 1;
+	StatusValue status = checkStatusByte(transaction());
+
+	while (attempt < policy.maxAttempts) {
+		const bool retryable = (status == NotUsed) ? policy.retryTransportErrors : ((status & policy.retryOn) != 0);
+		if (!retryable) {
+			break;
+		}
+
+		if (delayUs > 0) {
+			sleepUs(delayUs);
+		}
+		const uint64_t nextDelayUs = (uint64_t)delayUs * policy.backoffFactor;
+		delayUs = (nextDelayUs < policy.maxDelayUs) ? (uint32_t)nextDelayUs : policy.maxDelayUs;
+
+		// Slave restores memory from backup after corrupted write in its process() and rejects frames until then,
+		// as it does while callbacks are pending. Failed status frame does not stop retries, next attempt tells more.
+		if ( writesMemory || (status & Busy) ) {
+			const StatusValue ready = waitReady(sinfo, policy.readyTimeoutUs);
+			if ( (ready != NotUsed) && (ready & Busy) ) {
+				break;
+			}
+		}
+
+		attempt++;
+#if EMBEDDEDCOMM_STATS
+		getStatistics(sinfo).retries++;
+#endif
+		status = checkStatusByte(transaction());
+	}
+
+	if (attempts != nullptr) {
+		*attempts = attempt;
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+uint64_t GenericMaster<slaveInfo, Profile>::frameStart() {
+#if EMBEDDEDCOMM_STATS_TIMING
+	return getTimeUs();
+#else
+	return 0;
+#endif
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::frameDone(slaveInfo &sinfo, uint64_t start, uint32_t bytesOut, uint32_t bytesIn, StatusValue status) {
+#if EMBEDDEDCOMM_STATS
+	CommMasterStatistics &statistics = getStatistics(sinfo);
+	statistics.recordFrame(bytesOut, bytesIn, status);
+#if EMBEDDEDCOMM_STATS_TIMING
+	statistics.latency.record((uint32_t)(getTimeUs() - start));
+#endif
+#endif
+	return status;
+}
+
+#if EMBEDDEDCOMM_STATS
+template <typename slaveInfo, typename Profile>
+CommMasterStatistics &GenericMaster<slaveInfo, Profile>::getStatistics(slaveInfo &sinfo) {
+	return statistics;
+}
+#endif
+
+template <typename slaveInfo, typename Profile>
+StatusValue GenericMaster<slaveInfo, Profile>::waitReady(slaveInfo &sinfo, uint32_t timeoutUs) {
+	const uint64_t start = getTimeUs();
+
+	StatusValue status = readStatus(sinfo);
+	if (!(status & Busy)) {
+		return status;
+	}
+
+	// The first poll is aimed just after expected end of Busy, if it misses, delays restart short and grow.
+	uint32_t delay = busyEstimateUs + busyEstimateUs / 8;
+	delay = (delay > READY_POLL_MIN_US) ? delay : READY_POLL_MIN_US;
+	uint32_t nextDelay = READY_POLL_MIN_US;
+	uint64_t lastBusy = start;
+
+	while (true) {
+		const uint64_t elapsed = getTimeUs() - start;
+		if (elapsed >= timeoutUs) {
+			return status;
+		}
+
+		sleepUs( (delay < timeoutUs - elapsed) ? delay : (uint32_t)(timeoutUs - elapsed) );
+
+		const uint64_t pollTime = getTimeUs();
+		status = readStatus(sinfo);
+
+		if (!(status & Busy)) {
+			// Slave became ready somewhere between the last two polls.
+			if (status != 0) {
+				const uint64_t observed = (lastBusy + pollTime) / 2 - start;
+				const uint64_t estimate = ((uint64_t)busyEstimateUs * 3 + observed) / 4;
+				busyEstimateUs = (estimate < READY_POLL_MAX_US) ? (uint32_t)estimate : READY_POLL_MAX_US;
+			}
+			return status;
+		}
+
+		lastBusy = pollTime;
+		delay = nextDelay;
+		nextDelay = (nextDelay < READY_POLL_MAX_US / 2) ? nextDelay * 2 : READY_POLL_MAX_US;
+	}
+}
+
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+
+template <typename slaveInfo, typename Profile>
+uint64_t GenericMaster<slaveInfo, Profile>::getTimeUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::sleepUs(uint32_t delayUs) {
+	std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+}
+
+#else
+
+template <typename slaveInfo, typename Profile>
+uint64_t GenericMaster<slaveInfo, Profile>::getTimeUs() {
+	return sleptUs;
+}
+
+template <typename slaveInfo, typename Profile>
+void GenericMaster<slaveInfo, Profile>::sleepUs(uint32_t delayUs) {
+	sleptUs += delayUs;
+}
+
+#endif
+
+template <typename slaveInfo, typename Profile>
+int GenericMaster<slaveInfo, Profile>::writeBytesV(slaveInfo &sinfo, const CommSegment *segments, uint32_t numberOfSegments) {
+	uint32_t totalSize = 0;
+	for (uint32_t i = 0; i < numberOfSegments; i++) {
+		totalSize += segments[i].size;
+	}
+
+	uint8_t messageBuffer[totalSize];
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < numberOfSegments; i++) {
+		if (segments[i].size > 0) {
+			memcpy(&messageBuffer[offset], segments[i].data, segments[i].size);
+			offset += segments[i].size;
+		}
+	}
+
+	return writeBytes(sinfo, messageBuffer, totalSize);
 }
@@ -19,90 +19,277 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 
 #include "GenericSlave.hpp"
 
-GenericSlave::GenericSlave():
+template <typename Profile>
+BasicGenericSlave<Profile>::BasicGenericSlave():
 	memory(nullptr),
 	backupBuffer(nullptr),
+	requestBuffer(nullptr),
+	stagingBuffer(nullptr),
+	dirtyFlags(nullptr),
+	stream(nullptr),
 	backupBufferSize(0),
+	requestBufferSize(0),
+	stagingBufferSize(0),
 	memorySize(0),
 	currentNumberOfMemoryChangeCallbacks(0),
+	numberOfSortedCallbacks(0),
+	numberOfLongCallbacks(0),
+	pendingCount(0),
+	maxCallbackLength(1),
+	numberOfStreamWindows(0),
+	numberOfPages(0),
+	pageShift(0),
 	memoryAddress(0),
 	dataLength(0),
 	byteCounter(0),
+	backedUpLength(0),
 	checksum(0),
+	receivedChecksum(0),
+	responseLength(0),
+	responseCursor(0),
+	responseEntryByte(0),
+	responseEntryStatus(Ok),
+	headerSize(Profile::HEADER_SIZE),
+	lengthFieldSize(0),
+	streamCount(0),
+	streamRepeated(false),
+	checksumMode(Profile::CHECKSUM_MODE),
+	headerEncoding(HeaderFixed),
 	statusValue(Ok),
-	readMode(false)
+	restoreBackupPending(false),
+	readMode(false),
+	extendedFrame(false),
+	statusFrame(false),
+	readyPending(false)
+#if EMBEDDEDCOMM_STATS
+	, statisticsWindow(0),
+	statisticsWindowEnabled(false),
+	statisticsFrame(false)
+#endif
+#if EMBEDDEDCOMM_STATS_TIMING
+	, busySince(0)
+#endif
 {
 	for (uint32_t i = 0; i < MAX_MEMORY_CHANGE_CALLBACKS; i++) {
 		memoryChangeCallbacks[i] = MemoryChangeCallback();
+		sortedCallbacks[i] = 0;
+		longCallbacks[i] = 0;
+		longCallbackLast[i] = 0;
+		pendingQueue[i] = 0;
 		pendingCallbacks[i] = false;
 	}
+
+	for (uint32_t i = 0; i < CALLBACK_FILTER_WORDS; i++) {
+		callbackFilter[i] = 0;
+	}
 }
 
-void GenericSlave::initialize(uint8_t *memory, uint32_t memorySize) {
+template <typename Profile>
+void BasicGenericSlave<Profile>::initialize(uint8_t *memory, uint32_t memorySize) {
 	this->memory = memory;
 	this->memorySize = memorySize;
 }
 
-void GenericSlave::enableMemBackups(uint8_t *backupBuffer, uint32_t backupBufferSize) {
+template <typename Profile>
+void BasicGenericSlave<Profile>::enableMemBackups(uint8_t *backupBuffer, uint32_t backupBufferSize) {
 	this->backupBuffer = backupBuffer;
 	this->backupBufferSize = backupBufferSize;
 }
 
-void GenericSlave::process() {
+template <typename Profile>
+void BasicGenericSlave<Profile>::enableStagedWrites(uint8_t *stagingBuffer, uint32_t stagingBufferSize) {
+	this->stagingBuffer = stagingBuffer;
+	this->stagingBufferSize = stagingBufferSize;
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::enableDirtyTracking(uint8_t *dirtyFlags, uint32_t numberOfFlags, uint32_t pageSize) {
+	if ( (dirtyFlags == nullptr) || (pageSize == 0) || ((pageSize & (pageSize - 1)) != 0) ) {
+		return false;
+	}
+
+	uint32_t shift = 0;
+	while ((1u << shift) < pageSize) {
+		shift++;
+	}
+
+	const uint32_t pages = (memorySize >> shift) + (((memorySize & (pageSize - 1)) != 0) ? 1 : 0);
+	if (numberOfFlags < pages) {
+		return false;
+	}
+
+	// Master does not know initial contents, so everything is reported once.
+	for (uint32_t i = 0; i < pages; i++) {
+		dirtyFlags[i] = 1;
+	}
+
+	this->pageShift = shift;
+	this->numberOfPages = pages;
+	this->dirtyFlags = dirtyFlags;
+	return true;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::markDirty(uint32_t memoryAddress, uint32_t length) {
+	if (memoryAddress >= memorySize) {
+		return;
+	}
+
+	length = (length < memorySize - memoryAddress) ? length : (memorySize - memoryAddress);
+	markDirtyPages(memoryAddress, length);
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::writeMemory(uint32_t memoryAddress, const uint8_t *data, uint32_t length) {
+	if (memoryAddress >= memorySize) {
+		return;
+	}
+
+	length = (length < memorySize - memoryAddress) ? length : (memorySize - memoryAddress);
+
+	if (dirtyFlags == nullptr) {
+		memcpy(&memory[memoryAddress], data, length);
+		return;
+	}
+
+	// Compare page by page, unchanged pages stay clean.
+	while (length > 0) {
+		const uint32_t pageEnd = ((memoryAddress >> pageShift) + 1) << pageShift;
+		uint32_t n = pageEnd - memoryAddress;
+		n = (n < length) ? n : length;
+
+		if (memcmp(&memory[memoryAddress], data, n) != 0) {
+			memcpy(&memory[memoryAddress], data, n);
+			dirtyFlags[memoryAddress >> pageShift] = 1;
+		}
+
+		memoryAddress += n;
+		data += n;
+		length -= n;
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::setHeaderEncoding(HeaderEncoding encoding) {
+	headerEncoding = encoding;
+	headerSize = (headerEncoding == HeaderVarint) ? MAX_VARINT_HEADER_SIZE : Profile::HEADER_SIZE;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::enableExtendedFrames(uint8_t *requestBuffer, uint32_t requestBufferSize) {
+	this->requestBuffer = requestBuffer;
+	this->requestBufferSize = requestBufferSize;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::process() {
 	if (restoreBackupPending) {
 		restoreBackup();
 	}
 
 	if (statusValue == Busy) {
-		for (uint32_t i = 0; i < currentNumberOfMemoryChangeCallbacks; i++) {
-			if ( (pendingCallbacks[i]) && (memoryChangeCallbacks[i].callback != nullptr) ) {
-				memoryChangeCallbacks[i].callback();
-				pendingCallbacks[i] = false;
+#if EMBEDDEDCOMM_STATS
+		statistics.callbacksExecuted += pendingCount;
+#endif
+#if EMBEDDEDCOMM_STATS_TIMING
+		const uint32_t callbacksStart = getTimeUs();
+#endif
+
+		for (uint32_t i = 0; i < pendingCount; i++) {
+			MemoryChangeCallback &entry = memoryChangeCallbacks[pendingQueue[i]];
+
+			if (entry.rangeCallback != nullptr) {
+				entry.rangeCallback(entry.changedStart, entry.changedEnd - entry.changedStart, entry.context);
+			} else if (entry.callback != nullptr) {
+				entry.callback();
 			}
+			pendingCallbacks[pendingQueue[i]] = false;
 		}
+		pendingCount = 0;
+
+#if EMBEDDEDCOMM_STATS_TIMING
+		const uint32_t now = getTimeUs();
+		statistics.callbackTimeUs += now - callbacksStart;
+		if (now - callbacksStart > statistics.maxCallbackTimeUs) {
+			statistics.maxCallbackTimeUs = now - callbacksStart;
+		}
+		statistics.busyTimeUs += now - busySince;
+#endif
 
 		statusValue &= ~Busy;
 		if (statusValue == NotUsed) {
 			statusValue = Ok;
 		}
 	}
+
+	// Answer status frame waiting for callbacks to finish.
+	if ( readyPending && !(statusValue & Busy) ) {
+		readyPending = false;
+		sendToMaster(1);
+	}
 }
 
 // Handle all logic related to slave receiving byte from master.
-void GenericSlave::writeHandler(uint8_t receivedByte) {
+template <typename Profile>
+void BasicGenericSlave<Profile>::writeHandler(uint8_t receivedByte) {
+#if EMBEDDEDCOMM_STATS
+	statistics.bytesReceived++;
+#endif
 
 	// Handle received byte according to protocol
 	// its meaning is known based on byteCounter, 
 	// which tracks how many bytes where transferred since last reset.
 
-	// Received byte is a part of transfer size declared by master.
-	if (byteCounter < SLAVE_ADDRESS_SIZE) {
-		receiveDataLength(receivedByte);
-		checksum = calculateChecksumIt(checksum, receivedByte);
-
-	// Received byte is a part of memory address,
+	// Received byte is a part of frame header: data length followed by memory address,
 	// which is the first address from which master will read or to which master will write data.
-	} else if (byteCounter < SLAVE_ADDRESS_SIZE*2) {
-		receiveMemoryAddress(receivedByte);
-		checksum = calculateChecksumIt(checksum, receivedByte);
+	if (byteCounter < headerSize) {
+		if (headerEncoding == HeaderVarint) {
+			receiveVarintHeader(receivedByte);
+		} else if (byteCounter < Profile::LENGTH_SIZE) {
+			// Checksum is updated once whole field is received, since it carries checksum mode.
+			receiveDataLength(receivedByte);
+		} else {
+			receiveMemoryAddress(receivedByte);
+			checksum = checksumUpdate(frameChecksumMode(), checksum, receivedByte);
+		}
 
 	// Received byte data master writes to slave.
-	} else if (byteCounter < SLAVE_ADDRESS_SIZE*2 + dataLength) {
+	} else if (byteCounter < headerSize + dataLength) {
 		receiveData(receivedByte);
-		checksum = calculateChecksumIt(checksum, receivedByte);
+		checksum = checksumUpdate(frameChecksumMode(), checksum, receivedByte);
+
+	// Received byte is a part of checksum (little endian).
+	} else if (byteCounter < headerSize + dataLength + checksumSize(frameChecksumMode())) {
+		uint32_t checksumByte = byteCounter - headerSize - dataLength;
+		receivedChecksum |= (uint32_t)receivedByte << (checksumByte * 8);
+
+		if (checksumByte + 1 < checksumSize(frameChecksumMode())) {
+			byteCounter++;
+			return;
+		}
 
-	// Received byte is checksum
-	} else if (byteCounter == SLAVE_ADDRESS_SIZE*2 + dataLength) {
-		if (checksum != receivedByte) {
+		if (checksumFinalize(frameChecksumMode(), checksum) != receivedChecksum) {
 			setStatusValueFlag(ErrDataCorrupted, &statusValue);
+			clearPendingCallbacks();
+#if EMBEDDEDCOMM_STATS
+			statistics.checksumErrors++;
+#endif
+		}
 
-			for (uint32_t i = 0; i < currentNumberOfMemoryChangeCallbacks; i++) {
-				pendingCallbacks[i] = false;
+		// Extended frames are answered with response, its checksum and status.
+		if (extendedFrame) {
+			executeExtendedFrame();
+			sendToMaster(responseLength + checksumSize(frameChecksumMode()) + 1);
+		} else {
+			if ( (stream != nullptr) && (!readMode) && (statusValue == Ok) && (!streamRepeated) ) {
+				stream->writeRing->commit(dataLength);
+				stream->writeSequence = memoryAddress - stream->memoryAddress;
+			} else if ( (stagingBuffer != nullptr) && (!readMode) && (statusValue == Ok) ) {
+				commitStagedWrite();
 			}
+			sendToMaster(1);
 		}
 
-		sendToMaster(1);
-
 	// At this point only read request is acceptable (to read status).
 	} else {
 		setStatusValueFlag(ErrInvalidWrite, &statusValue);
@@ -111,16 +298,62 @@ void GenericSlave::writeHandler(uint8_t receivedByte) {
 	byteCounter++;
 }
 
-uint8_t GenericSlave::readHandler() {
+template <typename Profile>
+uint8_t BasicGenericSlave<Profile>::readHandler() {
 	uint8_t out_byte = 0x0;
 
-	// At this point of transfer master should write dataLength and memorySize
-	if (byteCounter < SLAVE_ADDRESS_SIZE*2) {
+#if EMBEDDEDCOMM_STATS
+	statistics.bytesSent++;
+#endif
+
+	// Status frame is answered with status byte only. It does not modify memory, so slave which is ready stays ready.
+	if (statusFrame) {
+#if EMBEDDEDCOMM_STATS
+		statistics.frames++;
+#endif
+		out_byte = (uint8_t)statusValue;
+		reset();
+		if (!(out_byte & Busy)) {
+			statusValue = Ok;
+		}
+		return out_byte;
+	}
+
+	// Response to extended frame follows its request and checksum.
+	const uint32_t responseStart = extendedFrame ? (headerSize + dataLength + checksumSize(frameChecksumMode())) : headerSize;
+	const uint32_t responseEnd = extendedFrame ? (responseStart + responseLength) : (headerSize + dataLength);
+
+	// At this point of transfer master should write dataLength and memorySize (or request of extended frame)
+	if (byteCounter < responseStart) {
 		setStatusValueFlag(ErrInvalidRead, &statusValue);
-	
+
+	// Return byte of response to extended frame
+	} else if (extendedFrame && (byteCounter < responseEnd)) {
+		if (statusValue == Ok) {
+			out_byte = nextResponseByte();
+		}
+
+	// Return byte of stream window.
+	} else if ( (stream != nullptr) && (byteCounter < responseEnd) ) {
+		if (!readMode) {
+			setStatusValueFlag(ErrInvalidRead, &statusValue);
+		}
+
+		if (statusValue == Ok) {
+			streamResponse(&out_byte, byteCounter - headerSize, 1);
+		}
+
+#if EMBEDDEDCOMM_STATS
+	// Return byte of statistics window.
+	} else if ( statisticsFrame && (byteCounter < responseEnd) ) {
+		if (statusValue == Ok) {
+			out_byte = ((const uint8_t*)&statisticsSnapshot)[memoryAddress - statisticsWindow + byteCounter - headerSize];
+		}
+#endif
+
 	// Return byte read from memory
-	} else if (byteCounter < SLAVE_ADDRESS_SIZE*2 + dataLength) {
-		uint32_t readAddress = byteCounter - SLAVE_ADDRESS_SIZE*2 + memoryAddress;
+	} else if (byteCounter < responseEnd) {
+		uint32_t readAddress = byteCounter - headerSize + memoryAddress;
 
 		if (!readMode) {
 			setStatusValueFlag(ErrInvalidRead, &statusValue);
@@ -135,36 +368,94 @@ uint8_t GenericSlave::readHandler() {
 		if (statusValue == Ok) {
 			out_byte = memory[readAddress];
 		}
-	
-		if (byteCounter == SLAVE_ADDRESS_SIZE*2+dataLength-1) {
-			sendToMaster(2);
-		}
 
-	// Return checksum byte
-	} else if (byteCounter == SLAVE_ADDRESS_SIZE*2 + dataLength) {
-		out_byte = checksum;
+	// Return checksum byte (little endian).
+	} else if (byteCounter < responseEnd + checksumSize(frameChecksumMode())) {
+		uint32_t checksumByte = byteCounter - responseEnd;
+		out_byte = (uint8_t)(checksumFinalize(frameChecksumMode(), checksum) >> (checksumByte * 8));
+		byteCounter++;
+		return out_byte;
 	
 	// Return status byte
 	} else {
-		if ( (statusValue & ErrDataCorrupted) && (backupBuffer != nullptr) ) {
+		// Only bytes saved in backup buffer were written to memory, extended frames, staged writes, stream windows,
+		// reads and frames rejected before their data never save any.
+		if ( (backedUpLength > 0) && (statusValue != Ok) ) {
 			restoreBackupPending = true;
-			setStatusValueFlag(Busy, &statusValue);
+			setBusy();
 		}
 
 		out_byte = (uint8_t)statusValue;
 
+#if EMBEDDEDCOMM_STATS
+		statistics.frames++;
+#endif
+
 		reset();
 		return out_byte;
 	} 
 
 	byteCounter++;
-	checksum = calculateChecksumIt(checksum, out_byte);
+	checksum = checksumUpdate(frameChecksumMode(), checksum, out_byte);
 	return out_byte;
 }
 
-void GenericSlave::reset() {
+template <typename Profile>
+void BasicGenericSlave<Profile>::writeHandler(const uint8_t *receivedBytes, uint32_t size) {
+	while (size > 0) {
+		const uint32_t payloadEnd = headerSize + dataLength;
+
+		// Payload of write transaction, try to handle all bytes at once.
+		if ( (byteCounter >= headerSize) && (byteCounter < payloadEnd) ) {
+			uint32_t n = payloadEnd - byteCounter;
+			n = (n < size) ? n : size;
+
+			if (receiveDataBlock(receivedBytes, n)) {
+#if EMBEDDEDCOMM_STATS
+				statistics.bytesReceived += n;
+#endif
+				receivedBytes += n;
+				size -= n;
+				continue;
+			}
+		}
+
+		writeHandler(*receivedBytes);
+		receivedBytes++;
+		size--;
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::readHandler(uint8_t *bytesToSend, uint32_t size) {
+	while (size > 0) {
+		const uint32_t payloadEnd = headerSize + dataLength;
+
+		// Requested data, try to copy all bytes at once.
+		if ( (byteCounter >= headerSize) && (byteCounter < payloadEnd) ) {
+			uint32_t n = payloadEnd - byteCounter;
+			n = (n < size) ? n : size;
+
+			if (sendDataBlock(bytesToSend, n)) {
+#if EMBEDDEDCOMM_STATS
+				statistics.bytesSent += n;
+#endif
+				bytesToSend += n;
+				size -= n;
+				continue;
+			}
+		}
+
+		*bytesToSend = readHandler();
+		bytesToSend++;
+		size--;
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::reset() {
 	if (currentNumberOfMemoryChangeCallbacks > 0) {
-		setStatusValueFlag(Busy, &statusValue);
+		setBusy();
 	}
 	
 	if (restoreBackupPending) {
@@ -172,9 +463,25 @@ void GenericSlave::reset() {
 	}
 
 	byteCounter = 0;
+	backedUpLength = 0;
 	dataLength = 0;
 	memoryAddress = 0;
 	checksum = 0;
+	receivedChecksum = 0;
+	responseLength = 0;
+	responseCursor = 0;
+	responseEntryByte = 0;
+	extendedFrame = false;
+	statusFrame = false;
+	readyPending = false;
+#if EMBEDDEDCOMM_STATS
+	statisticsFrame = false;
+#endif
+	stream = nullptr;
+	streamCount = 0;
+	streamRepeated = false;
+	lengthFieldSize = 0;
+	headerSize = (headerEncoding == HeaderVarint) ? MAX_VARINT_HEADER_SIZE : Profile::HEADER_SIZE;
 
 	statusValue &= Busy;
 	if (statusValue == 0) {
@@ -182,42 +489,305 @@ void GenericSlave::reset() {
 	}
 }
 
-void GenericSlave::restoreBackup() {
-	memcpy(&memory[memoryAddress], backupBuffer, dataLength);
+template <typename Profile>
+void BasicGenericSlave<Profile>::restoreBackup() {
+	memcpy(&memory[memoryAddress], backupBuffer, backedUpLength);
+	markDirtyPages(memoryAddress, backedUpLength);
 	restoreBackupPending = false;
+#if EMBEDDEDCOMM_STATS
+	statistics.backupRestores++;
+#endif
 	reset();
 }
 
-void GenericSlave::receiveDataLength(uint8_t receivedByte) {
+template <typename Profile>
+void BasicGenericSlave<Profile>::receiveDataLength(uint8_t receivedByte) {
 	dataLength |= (uint32_t)receivedByte << (byteCounter * 8);
 	
-	if (byteCounter == SLAVE_ADDRESS_SIZE-1) {
-		readMode = dataLength & (1 << 31); // Capture read flag
-		dataLength &= ~(1 << 31); // Clear read flag to store dataLength
-		
-		// Check for buckup buffer overflow (write operations only).
-		if ( (backupBuffer != nullptr) && (!readMode) && (dataLength > backupBufferSize) ) {
-			setStatusValueFlag(ErrBackupBufferOverflow, &statusValue);
+	if (byteCounter == Profile::LENGTH_SIZE-1) {
+		uint32_t lengthField = dataLength;
+
+		uint8_t mode = Profile::CHECKSUM_MODE;
+		if constexpr (Profile::CHECKSUM_IN_HEADER) {
+			mode = (lengthField & Profile::CHECKSUM_MODE_MASK) >> Profile::CHECKSUM_MODE_SHIFT;
 		}
+		selectChecksumMode(mode);
+
+		for (uint32_t i = 0; i < Profile::LENGTH_SIZE; i++) {
+			checksum = checksumUpdate(frameChecksumMode(), checksum, (uint8_t)(lengthField >> (i * 8)));
+		}
+
+		dataLengthReceived(lengthField & Profile::READ_FLAG, lengthField & Profile::EXTENDED_FLAG, lengthField & Profile::DATA_LENGTH_MASK);
 	}
 	
 }
 
-void GenericSlave::receiveMemoryAddress(uint8_t receivedByte) {
-	memoryAddress |= (uint32_t)receivedByte << ( (byteCounter - SLAVE_ADDRESS_SIZE) * 8 );
+template <typename Profile>
+void BasicGenericSlave<Profile>::receiveMemoryAddress(uint8_t receivedByte) {
+	memoryAddress |= (uint32_t)receivedByte << ( (byteCounter - Profile::LENGTH_SIZE) * 8 );
+
+	if  (byteCounter == Profile::HEADER_SIZE-1) {
+		memoryAddressReceived();
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::receiveVarintHeader(uint8_t receivedByte) {
+	// Checksum mode is carried by the first byte, so checksum can be updated byte by byte.
+	if (byteCounter == 0) {
+		uint8_t mode = Profile::CHECKSUM_MODE;
+		if constexpr (Profile::CHECKSUM_IN_HEADER) {
+			mode = (receivedByte >> VARINT_CHECKSUM_MODE_SHIFT) & 3;
+		}
+		selectChecksumMode(mode);
+	}
+	checksum = checksumUpdate(frameChecksumMode(), checksum, receivedByte);
+
+	const bool more = receivedByte & 0x80;
+	const uint32_t fieldByte = byteCounter - lengthFieldSize; // lengthFieldSize is 0 until length field is received.
+	const uint32_t value = (uint32_t)(receivedByte & 0x7F) << (fieldByte * 7);
+
+	if (more && (fieldByte + 1 < MAX_VARINT_SIZE)) {
+		if (lengthFieldSize == 0) {
+			dataLength |= value;
+		} else {
+			memoryAddress |= value;
+		}
+		return;
+	}
+
+	// Value does not fit 32 bits, rest of the header cannot be located. Rejected as malformed header.
+	if (more) {
+		setStatusValueFlag(ErrInvalidRequest, &statusValue);
+	}
+
+	if (lengthFieldSize == 0) {
+		lengthFieldSize = byteCounter + 1;
+
+		uint32_t lengthField = dataLength | value;
+		const uint32_t flagBits = Profile::CHECKSUM_IN_HEADER ? (VARINT_CHECKSUM_MODE_SHIFT + 2) : VARINT_CHECKSUM_MODE_SHIFT;
+
+		dataLengthReceived(lengthField & VARINT_READ_FLAG, lengthField & VARINT_EXTENDED_FLAG, (lengthField >> flagBits) & Profile::DATA_LENGTH_MASK);
+	} else {
+		memoryAddress |= value;
+		headerSize = byteCounter + 1;
+
+		memoryAddressReceived();
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::selectChecksumMode(uint8_t mode) {
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		if (mode > ChecksumCRC32C) {
+			// Reserved value, frame cannot be verified. Rejected as malformed header, it is not a checksum mismatch.
+			mode = ChecksumCRC8;
+			setStatusValueFlag(ErrInvalidRequest, &statusValue);
+		}
+	}
+
+	checksumMode = (ChecksumMode)mode;
+	checksum = checksumInit(frameChecksumMode());
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::dataLengthReceived(bool read, bool extended, uint32_t length) {
+	readMode = read;
+	extendedFrame = extended;
+	dataLength = length;
+
+	// Extended frame always starts with request sent by master, read flag marks status frame instead.
+	if (extendedFrame && readMode) {
+		if (length > READY_FRAME_LENGTH) {
+			setStatusValueFlag(ErrInvalidRequest, &statusValue);
+			return;
+		}
+
+		statusFrame = true;
+		dataLength = 0;
+
+		if ( (length == READY_FRAME_LENGTH) && (statusValue & Busy) ) {
+			readyPending = true;
+		} else {
+			sendToMaster(1);
+		}
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::memoryAddressReceived() {
+	// Address field of extended frame carries opcode and size of expected response.
+	if (extendedFrame) {
+		uint8_t opcode = memoryAddress & EXTENDED_OPCODE_MASK;
+		responseLength = memoryAddress >> EXTENDED_RESPONSE_SHIFT;
+
+		// Limits request has no data, so master may ask for limits before it knows whether request buffer exists.
+		if ( (opcode == OpLimits) && (dataLength == 0) ) {
+			return;
+		}
+
+		if ( ((opcode != OpBatch) && (opcode != OpAtomic) && (opcode != OpDirtyMap)) || (requestBuffer == nullptr) || (dataLength > requestBufferSize) ) {
+			setStatusValueFlag(ErrInvalidRequest, &statusValue);
+		}
+		return;
+	}
+
+#if EMBEDDEDCOMM_STATS
+	// Statistics window is read only, copy is taken so that whole response is consistent.
+	if ( statisticsWindowEnabled && (memoryAddress - statisticsWindow < sizeof(CommSlaveStatistics)) ) {
+		statisticsFrame = true;
+
+		if (!readMode) {
+			setStatusValueFlag(ErrInvalidWrite, &statusValue);
+		} else if (dataLength > statisticsWindow + sizeof(CommSlaveStatistics) - memoryAddress) {
+			setStatusValueFlag(ErrMemoryOutOfRange, &statusValue);
+		} else {
+			statisticsSnapshot = statistics;
+		}
 
-	if  (byteCounter == SLAVE_ADDRESS_SIZE*2-1) {
 		if (readMode) {
-			sendToMaster(dataLength);
+			sendToMaster(dataLength + checksumSize(frameChecksumMode()) + 1);
 		}
+		return;
+	}
+#endif
 
+	stream = findStreamWindow(memoryAddress);
+	if (stream != nullptr) {
+		openStream();
+	} else {
 		if ( (memoryAddress + dataLength >= memorySize) ) {
 			setStatusValueFlag(ErrMemoryOutOfRange, &statusValue);
 		}
+
+		// Check for buckup buffer overflow (write operations only).
+		const uint32_t writeBufferSize = (stagingBuffer != nullptr) ? stagingBufferSize : backupBufferSize;
+		const bool writeBuffered = (stagingBuffer != nullptr) || (backupBuffer != nullptr);
+		if ( writeBuffered && (!readMode) && (dataLength > writeBufferSize) ) {
+			setStatusValueFlag(ErrBackupBufferOverflow, &statusValue);
+		}
 	}
+
+	// Whole response is announced at once, so it can be sent as one continuous stream.
+	if (readMode) {
+		sendToMaster(dataLength + checksumSize(frameChecksumMode()) + 1);
+	}
+}
+
+#if EMBEDDEDCOMM_STATS
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::enableStatisticsWindow(uint32_t memoryAddress) {
+	statisticsWindow = memoryAddress;
+	statisticsWindowEnabled = true;
+}
+
+template <typename Profile>
+const CommSlaveStatistics &BasicGenericSlave<Profile>::getStatistics() const {
+	return statistics;
 }
 
-void GenericSlave::receiveData(uint8_t receivedByte) {
+template <typename Profile>
+void BasicGenericSlave<Profile>::resetStatistics() {
+	statistics = CommSlaveStatistics();
+}
+#endif
+
+#if EMBEDDEDCOMM_STATS_TIMING
+#if defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::getTimeUs() {
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::getTimeUs() {
+	return 0;
+}
+#endif
+
+#endif
+
+template <typename Profile>
+StreamWindow *BasicGenericSlave<Profile>::findStreamWindow(uint32_t address) {
+	for (uint32_t i = 0; i < numberOfStreamWindows; i++) {
+		if (address - streamWindows[i].memoryAddress < STREAM_WINDOW_SIZE) {
+			return &streamWindows[i];
+		}
+	}
+
+	return nullptr;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::openStream() {
+	const uint8_t sequence = memoryAddress - stream->memoryAddress;
+
+	// Nothing is acknowledged or consumed by frames which already failed (eg. slave is busy), master repeats them.
+	if (statusValue != Ok) {
+		streamRepeated = true;
+		return;
+	}
+
+	if (readMode) {
+		if ( (stream->readRing == nullptr) || (dataLength < STREAM_COUNT_SIZE) ) {
+			setStatusValueFlag(ErrInvalidRead, &statusValue);
+			return;
+		}
+
+		// New sequence bit acknowledges previous response, its bytes are removed from ring.
+		streamRepeated = (sequence == stream->readSequence);
+		if (!streamRepeated) {
+			stream->readRing->discard(stream->sentCount);
+			stream->sentCount = stream->readRing->available();
+			stream->readSequence = sequence;
+		}
+
+		uint32_t capacity = dataLength - STREAM_COUNT_SIZE;
+		capacity = (capacity < MAX_STREAM_READ_SIZE) ? capacity : MAX_STREAM_READ_SIZE;
+
+		streamCount = (stream->sentCount < capacity) ? stream->sentCount : capacity;
+		stream->sentCount = streamCount;
+	} else {
+		if (stream->writeRing == nullptr) {
+			setStatusValueFlag(ErrInvalidWrite, &statusValue);
+			return;
+		}
+
+		// Repeated write was already applied, data is received and dropped.
+		streamRepeated = (sequence == stream->writeSequence);
+		if ( (!streamRepeated) && (dataLength > stream->writeRing->space()) ) {
+			setStatusValueFlag(ErrBackupBufferOverflow, &statusValue);
+		}
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::streamResponse(uint8_t *bytes, uint32_t offset, uint32_t size) const {
+	while ( (size > 0) && (offset < STREAM_COUNT_SIZE) ) {
+		*bytes++ = (uint8_t)(streamCount >> (offset * 8));
+		offset++;
+		size--;
+	}
+
+	const uint32_t dataOffset = offset - STREAM_COUNT_SIZE;
+	uint32_t n = (dataOffset < streamCount) ? (streamCount - dataOffset) : 0;
+	n = (n < size) ? n : size;
+
+	stream->readRing->peek(bytes, n, dataOffset);
+	memset(bytes + n, 0, size - n);
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::receiveData(uint8_t receivedByte) {
+	// Request of extended frame is stored until its checksum is verified.
+	if (extendedFrame) {
+		if (statusValue == Ok) {
+			requestBuffer[byteCounter - headerSize] = receivedByte;
+		}
+		return;
+	}
+
 	if (readMode) {
 		setStatusValueFlag(ErrInvalidWrite, &statusValue);
 	}
@@ -226,8 +796,16 @@ void GenericSlave::receiveData(uint8_t receivedByte) {
 	if (statusValue != Ok) {
 		return;
 	}
+
+	// Stream data is staged in ring and made available once checksum is verified.
+	if (stream != nullptr) {
+		if (!streamRepeated) {
+			stream->writeRing->stage(&receivedByte, 1, byteCounter - headerSize);
+		}
+		return;
+	}
 	
-	uint32_t writeAddress = memoryAddress + byteCounter - SLAVE_ADDRESS_SIZE*2;
+	uint32_t writeAddress = memoryAddress + byteCounter - headerSize;
 
 	if (writeAddress >= memorySize) {
 		setStatusValueFlag(ErrMemoryOutOfRange, &statusValue);
@@ -235,6 +813,18 @@ void GenericSlave::receiveData(uint8_t receivedByte) {
 		return;
 	}
 
+	// Staged data is compared with memory and copied in commitStagedWrite().
+	if (stagingBuffer != nullptr) {
+		if (writeAddress - memoryAddress >= stagingBufferSize) {
+			setStatusValueFlag(ErrBackupBufferOverflow, &statusValue);
+			byteCounter++;
+			return;
+		}
+
+		stagingBuffer[writeAddress - memoryAddress] = receivedByte;
+		return;
+	}
+
 	if (backupBuffer != nullptr) {
 		if (writeAddress - memoryAddress >= backupBufferSize) {
 			setStatusValueFlag(ErrBackupBufferOverflow, &statusValue);
@@ -243,35 +833,686 @@ void GenericSlave::receiveData(uint8_t receivedByte) {
 		}
 			
 		backupBuffer[writeAddress - memoryAddress] = memory[writeAddress];
+		backedUpLength = writeAddress - memoryAddress + 1;
 	}
 	
-	bool change = (receivedByte != memory[writeAddress]);
+	if ( (receivedByte != memory[writeAddress]) && callbackFilterHit(writeAddress) ) {
+		markChangedCallbacks(writeAddress, &receivedByte, 1);
+	}
 
 	memory[writeAddress] = receivedByte;
+	markDirtyPages(writeAddress, 1);
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::receiveDataBlock(const uint8_t *receivedBytes, uint32_t size) {
+	if ( readMode || (statusValue != Ok) ) {
+		return false;
+	}
+
+	const uint32_t offset = byteCounter - headerSize;
 
-	if (change) {
-		for (uint32_t i = 0; i < currentNumberOfMemoryChangeCallbacks; i++) {
-			if (memoryChangeCallbacks[i].memoryAddress == writeAddress) {
-				pendingCallbacks[i] = true;
+	// Request size was checked against requestBuffer in header.
+	if (extendedFrame) {
+		memcpy(&requestBuffer[offset], receivedBytes, size);
+
+		checksum = checksumUpdate(frameChecksumMode(), checksum, receivedBytes, size);
+		byteCounter += size;
+
+		return true;
+	}
+
+	if (stream != nullptr) {
+		if (!streamRepeated) {
+			stream->writeRing->stage(receivedBytes, size, offset);
+		}
+
+		checksum = checksumUpdate(frameChecksumMode(), checksum, receivedBytes, size);
+		byteCounter += size;
+
+		return true;
+	}
+
+	const uint32_t writeAddress = memoryAddress + offset;
+
+	if ( (writeAddress >= memorySize) || (size > memorySize - writeAddress) ) {
+		return false;
+	}
+
+	if (stagingBuffer != nullptr) {
+		if ( (offset >= stagingBufferSize) || (size > stagingBufferSize - offset) ) {
+			return false;
+		}
+
+		memcpy(&stagingBuffer[offset], receivedBytes, size);
+
+		checksum = checksumUpdate(frameChecksumMode(), checksum, receivedBytes, size);
+		byteCounter += size;
+
+		return true;
+	}
+
+	if (backupBuffer != nullptr) {
+		if ( (offset >= backupBufferSize) || (size > backupBufferSize - offset) ) {
+			return false;
+		}
+
+		memcpy(&backupBuffer[offset], &memory[writeAddress], size);
+		backedUpLength = offset + size;
+	}
+
+	markChangedCallbacks(writeAddress, receivedBytes, size);
+
+	memcpy(&memory[writeAddress], receivedBytes, size);
+	markDirtyPages(writeAddress, size);
+
+	checksum = checksumUpdate(frameChecksumMode(), checksum, receivedBytes, size);
+	byteCounter += size;
+
+	return true;
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::sendDataBlock(uint8_t *bytesToSend, uint32_t size) {
+	if ( (!readMode) || (statusValue != Ok) ) {
+		return false;
+	}
+
+	if (stream != nullptr) {
+		streamResponse(bytesToSend, byteCounter - headerSize, size);
+#if EMBEDDEDCOMM_STATS
+	} else if (statisticsFrame) {
+		memcpy(bytesToSend, &((const uint8_t*)&statisticsSnapshot)[memoryAddress - statisticsWindow + byteCounter - headerSize], size);
+#endif
+	} else {
+		const uint32_t readAddress = byteCounter - headerSize + memoryAddress;
+
+		if ( (readAddress >= memorySize) || (size > memorySize - readAddress) ) {
+			return false;
+		}
+
+		memcpy(bytesToSend, &memory[readAddress], size);
+	}
+
+	checksum = checksumUpdate(frameChecksumMode(), checksum, bytesToSend, size);
+	byteCounter += size;
+
+	return true;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::commitStagedWrite() {
+	// Range was checked while data was received.
+	markChangedCallbacks(memoryAddress, stagingBuffer, dataLength);
+	memcpy(&memory[memoryAddress], stagingBuffer, dataLength);
+	markDirtyPages(memoryAddress, dataLength);
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::executeExtendedFrame() {
+	responseCursor = 0;
+	responseEntryByte = 0;
+
+	// Corrupted or rejected requests are not executed, response is filled with zeros.
+	if (statusValue != Ok) {
+		return;
+	}
+
+	switch (memoryAddress & EXTENDED_OPCODE_MASK) {
+		case OpBatch:
+			// Master and slave must agree on response size, otherwise status byte would be missed.
+			if (checkBatch() != responseLength) {
+				setStatusValueFlag(ErrInvalidRequest, &statusValue);
+				return;
+			}
+
+			executeBatchWrites();
+			break;
+
+		case OpAtomic:
+			if (checkAtomic() != responseLength) {
+				setStatusValueFlag(ErrInvalidRequest, &statusValue);
+				return;
+			}
+
+			executeAtomic();
+			break;
+
+		case OpDirtyMap: {
+			uint32_t pages = 0;
+			if (dataLength == DIRTY_MAP_REQUEST_SIZE) {
+				memcpy(&pages, &requestBuffer[4], sizeof(pages));
+			}
+
+			// Pages are cleared while response is sent, so only valid requests may get there.
+			if ( (pages == 0) || (pages / 8 + ((pages % 8) ? 1 : 0) != responseLength) ) {
+				setStatusValueFlag(ErrInvalidRequest, &statusValue);
 			}
+			break;
 		}
+
+		case OpLimits:
+			if (responseLength != SLAVE_LIMITS_SIZE) {
+				setStatusValueFlag(ErrInvalidRequest, &statusValue);
+			}
+			break;
+
+		default:
+			setStatusValueFlag(ErrInvalidRequest, &statusValue);
 	}
 }
 
-bool GenericSlave::addMemoryChangeCallback(uint32_t memoryAddress, CallbackFunction callback) {
-	if (currentNumberOfMemoryChangeCallbacks + 1 >= MAX_MEMORY_CHANGE_CALLBACKS) {
+template <typename Profile>
+uint8_t BasicGenericSlave<Profile>::nextResponseByte() {
+	switch (memoryAddress & EXTENDED_OPCODE_MASK) {
+		case OpBatch:
+			return nextBatchResponseByte();
+
+		// Response of atomic operation is stored in place of its request.
+		case OpAtomic:
+			return requestBuffer[responseCursor++];
+
+		case OpDirtyMap:
+			return nextDirtyMapByte();
+
+		case OpLimits:
+			return nextLimitsByte();
+
+		default:
+			return 0;
+	}
+}
+
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::checkBatch() const {
+	uint32_t offset = 0;
+	uint32_t responseSize = 0;
+
+	while (offset < dataLength) {
+		if (dataLength - offset < BATCH_ENTRY_HEADER_SIZE) {
+			return UINT32_MAX;
+		}
+
+		const uint8_t operation = requestBuffer[offset];
+		uint16_t length;
+		memcpy(&length, &requestBuffer[offset + 5], sizeof(length));
+		offset += BATCH_ENTRY_HEADER_SIZE;
+
+		if (operation == BatchWrite) {
+			if (dataLength - offset < length) {
+				return UINT32_MAX;
+			}
+			offset += length;
+			responseSize += 1;
+		} else if (operation == BatchRead) {
+			responseSize += 1 + length;
+		} else {
+			return UINT32_MAX;
+		}
+	}
+
+	return responseSize;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::executeBatchWrites() {
+	uint32_t offset = 0;
+
+	while (offset < dataLength) {
+		const uint8_t operation = requestBuffer[offset];
+		uint32_t address;
+		uint16_t length;
+		memcpy(&address, &requestBuffer[offset + 1], sizeof(address));
+		memcpy(&length, &requestBuffer[offset + 5], sizeof(length));
+		offset += BATCH_ENTRY_HEADER_SIZE;
+
+		if (operation != BatchWrite) {
+			continue;
+		}
+
+		if (batchEntryStatus(address, length) == Ok) {
+			markChangedCallbacks(address, &requestBuffer[offset], length);
+			memcpy(&memory[address], &requestBuffer[offset], length);
+			markDirtyPages(address, length);
+		}
+		offset += length;
+	}
+}
+
+template <typename Profile>
+uint8_t BasicGenericSlave<Profile>::nextBatchResponseByte() {
+	const uint8_t *entry = &requestBuffer[responseCursor];
+	uint32_t address;
+	uint16_t length;
+	memcpy(&address, &entry[1], sizeof(address));
+	memcpy(&length, &entry[5], sizeof(length));
+
+	const bool read = (entry[0] == BatchRead);
+
+	// Entry is answered with its status, reads are followed by data.
+	if (responseEntryByte == 0) {
+		responseEntryStatus = batchEntryStatus(address, length);
+
+		// Writes were applied before response, so read would see data of writes added after it.
+		if ( read && (responseEntryStatus == Ok) && batchReadOverwritten(responseCursor) ) {
+			responseEntryStatus = ErrInvalidRequest;
+		}
+	}
+
+	uint8_t out_byte = responseEntryStatus;
+	if (responseEntryByte > 0) {
+		out_byte = (responseEntryStatus == Ok) ? memory[address + responseEntryByte - 1] : 0;
+	}
+
+	const uint32_t entryResponseSize = 1 + (read ? (uint32_t)length : 0);
+
+	responseEntryByte++;
+	if (responseEntryByte == entryResponseSize) {
+		responseCursor += BATCH_ENTRY_HEADER_SIZE + (read ? 0 : length);
+		responseEntryByte = 0;
+	}
+
+	return out_byte;
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::batchReadOverwritten(uint32_t entryOffset) const {
+	uint32_t readAddress;
+	uint16_t readLength;
+	memcpy(&readAddress, &requestBuffer[entryOffset + 1], sizeof(readAddress));
+	memcpy(&readLength, &requestBuffer[entryOffset + 5], sizeof(readLength));
+
+	// Request was checked by checkBatch(), entries are well formed.
+	uint32_t offset = entryOffset + BATCH_ENTRY_HEADER_SIZE;
+	while (offset < dataLength) {
+		uint32_t address;
+		uint16_t length;
+		memcpy(&address, &requestBuffer[offset + 1], sizeof(address));
+		memcpy(&length, &requestBuffer[offset + 5], sizeof(length));
+
+		if (requestBuffer[offset] == BatchWrite) {
+			if ( (address < readAddress + readLength) && (readAddress < address + length) ) {
+				return true;
+			}
+			offset += length;
+		}
+		offset += BATCH_ENTRY_HEADER_SIZE;
+	}
+
+	return false;
+}
+
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::checkAtomic() const {
+	if (dataLength < ATOMIC_REQUEST_HEADER_SIZE) {
+		return UINT32_MAX;
+	}
+
+	const uint8_t operation = requestBuffer[0];
+	const uint8_t width = requestBuffer[1];
+	const uint32_t operands = (operation == AtomicCompareSwap) ? 2 : 1;
+
+	if ( (operation > AtomicSwap) || ((width != 1) && (width != 2) && (width != 4)) ||
+		(dataLength != ATOMIC_REQUEST_HEADER_SIZE + width * operands) ) {
+		return UINT32_MAX;
+	}
+
+	return 1 + width;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::executeAtomic() {
+	const uint8_t operation = requestBuffer[0];
+	const uint8_t width = requestBuffer[1];
+	uint32_t address;
+	uint32_t operand = 0;
+	uint32_t newValue = 0;
+	memcpy(&address, &requestBuffer[2], sizeof(address));
+	memcpy(&operand, &requestBuffer[ATOMIC_REQUEST_HEADER_SIZE], width);
+	if (operation == AtomicCompareSwap) {
+		memcpy(&newValue, &requestBuffer[ATOMIC_REQUEST_HEADER_SIZE + width], width);
+	}
+
+	const StatusValue status = batchEntryStatus(address, width);
+	uint32_t oldValue = 0;
+
+	if (status == Ok) {
+		memcpy(&oldValue, &memory[address], width);
+		uint32_t value = oldValue;
+
+		switch (operation) {
+			case AtomicFetchAdd:
+				value = oldValue + operand;
+				break;
+
+			case AtomicCompareSwap:
+				value = (oldValue == operand) ? newValue : oldValue;
+				break;
+
+			case AtomicSetBits:
+				value = oldValue | operand;
+				break;
+
+			case AtomicClearBits:
+				value = oldValue & ~operand;
+				break;
+
+			case AtomicSwap:
+				value = operand;
+				break;
+		}
+
+		// Only width lower bytes are stored, so results wrap around as in field of that width.
+		uint8_t newBytes[4];
+		memcpy(newBytes, &value, sizeof(newBytes));
+		markChangedCallbacks(address, newBytes, width);
+		memcpy(&memory[address], newBytes, width);
+		markDirtyPages(address, width);
+	}
+
+	requestBuffer[0] = status;
+	memcpy(&requestBuffer[1], &oldValue, width);
+}
+
+template <typename Profile>
+uint8_t BasicGenericSlave<Profile>::nextDirtyMapByte() {
+	uint32_t firstPage;
+	memcpy(&firstPage, &requestBuffer[0], sizeof(firstPage));
+
+	// Pages outside memory or without tracking are never dirty.
+	uint8_t mapByte = 0;
+	for (uint32_t bit = 0; (bit < 8) && (dirtyFlags != nullptr); bit++) {
+		const uint32_t page = firstPage + responseCursor * 8 + bit;
+
+		if ( (page >= firstPage) && (page < numberOfPages) && dirtyFlags[page] ) {
+			dirtyFlags[page] = 0;
+			mapByte |= 1u << bit;
+		}
+	}
+
+	responseCursor++;
+	return mapByte;
+}
+
+template <typename Profile>
+uint8_t BasicGenericSlave<Profile>::nextLimitsByte() {
+	// Writes are limited by buffer holding their data until checksum is verified, otherwise only by length field.
+	uint32_t maxWriteSize = Profile::DATA_LENGTH_MASK;
+	if (stagingBuffer != nullptr) {
+		maxWriteSize = stagingBufferSize;
+	} else if (backupBuffer != nullptr) {
+		maxWriteSize = backupBufferSize;
+	}
+
+	const uint32_t limits[SLAVE_LIMITS_SIZE / 4] = {memorySize, maxWriteSize, (requestBuffer != nullptr) ? requestBufferSize : 0};
+	return ((const uint8_t*)limits)[responseCursor++];
+}
+
+template <typename Profile>
+StatusValue BasicGenericSlave<Profile>::batchEntryStatus(uint32_t address, uint32_t length) const {
+	if ( (length > memorySize) || (address > memorySize - length) ) {
+		return ErrMemoryOutOfRange;
+	}
+
+	return Ok;
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::addStreamWindow(uint32_t memoryAddress, CommRing *readRing, CommRing *writeRing) {
+	if (numberOfStreamWindows >= MAX_STREAM_WINDOWS) {
 		return false;
 	}
 
-	memoryChangeCallbacks[currentNumberOfMemoryChangeCallbacks].memoryAddress = memoryAddress; 
-	memoryChangeCallbacks[currentNumberOfMemoryChangeCallbacks].callback = callback;
+	StreamWindow &window = streamWindows[numberOfStreamWindows];
+	window = StreamWindow();
+	window.memoryAddress = memoryAddress;
+	window.readRing = readRing;
+	window.writeRing = writeRing;
+
+	numberOfStreamWindows++;
+	return true;
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::addMemoryChangeCallback(uint32_t memoryAddress, CallbackFunction callback) {
+	MemoryChangeCallback entry;
+	entry.memoryAddress = memoryAddress;
+	entry.length = 1;
+	entry.callback = callback;
+
+	return insertCallback(entry);
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::addMemoryChangeCallback(uint32_t memoryAddress, uint32_t length, RangeCallbackFunction callback, void *context) {
+	if ( (length == 0) || (length - 1 > UINT32_MAX - memoryAddress) ) {
+		return false;
+	}
+
+	MemoryChangeCallback entry;
+	entry.memoryAddress = memoryAddress;
+	entry.length = length;
+	entry.rangeCallback = callback;
+	entry.context = context;
+
+	return insertCallback(entry);
+}
+
+template <typename Profile>
+bool BasicGenericSlave<Profile>::insertCallback(const MemoryChangeCallback &callback) {
+	if (currentNumberOfMemoryChangeCallbacks >= MAX_MEMORY_CHANGE_CALLBACKS) {
+		return false;
+	}
+
+	const uint16_t index = currentNumberOfMemoryChangeCallbacks;
+	memoryChangeCallbacks[index] = callback;
+
+	// Long ranges do not widen search of sortedCallbacks, they are found by their ends instead.
+	const bool longCallback = (callback.length > LONG_CALLBACK_LENGTH);
+	uint16_t *table = longCallback ? longCallbacks : sortedCallbacks;
+	uint32_t &count = longCallback ? numberOfLongCallbacks : numberOfSortedCallbacks;
+
+	// Keep table sorted by memory address (insert after callbacks with equal address).
+	uint32_t position = findFirstCallback(table, count, callback.memoryAddress + 1);
+	if (callback.memoryAddress == UINT32_MAX) {
+		position = count;
+	}
+
+	for (uint32_t i = count; i > position; i--) {
+		table[i] = table[i-1];
+	}
+	table[position] = index;
+	count++;
+
+	if (longCallback) {
+		buildLongCallbackTree(0, numberOfLongCallbacks);
+	}
+
+	// Mark all pages covered by watched range.
+	const uint32_t filterBits = CALLBACK_FILTER_WORDS * 32;
+	const uint32_t firstPage = callback.memoryAddress >> CALLBACK_FILTER_PAGE_SHIFT;
+	const uint32_t lastPage = (callback.memoryAddress + (callback.length - 1)) >> CALLBACK_FILTER_PAGE_SHIFT;
+	for (uint32_t page = firstPage; (page - firstPage <= lastPage - firstPage) && (page - firstPage < filterBits); page++) {
+		uint32_t bit = page % filterBits;
+		callbackFilter[bit / 32] |= 1u << (bit % 32);
+	}
+
+	if ( (!longCallback) && (callback.length > maxCallbackLength) ) {
+		maxCallbackLength = callback.length;
+	}
 
 	currentNumberOfMemoryChangeCallbacks++;
 	
 	return true;
 }
 
+template <typename Profile>
+inline bool BasicGenericSlave<Profile>::callbackFilterHit(uint32_t address) const {
+	uint32_t bit = (address >> CALLBACK_FILTER_PAGE_SHIFT) % (CALLBACK_FILTER_WORDS * 32);
+	return callbackFilter[bit / 32] & (1u << (bit % 32));
+}
+
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::findFirstCallback(const uint16_t *table, uint32_t count, uint32_t address) const {
+	uint32_t low = 0;
+	uint32_t high = count;
+
+	while (low < high) {
+		uint32_t middle = (low + high) / 2;
+
+		if (memoryChangeCallbacks[table[middle]].memoryAddress < address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::markChangedCallbacks(uint32_t address, const uint8_t *newData, uint32_t size) {
+	if ( (currentNumberOfMemoryChangeCallbacks == 0) || (size == 0) ) {
+		return;
+	}
+
+	// Only callbacks of sortedCallbacks starting less than maxCallbackLength bytes before address can overlap
+	// written span. Long callbacks reaching address and starting before span end are merged in, so callbacks
+	// are queued in address order.
+	const uint32_t searchStart = (address > maxCallbackLength - 1) ? address - (maxCallbackLength - 1) : 0;
+	const uint64_t spanEnd = (uint64_t)address + size;
+	uint32_t i = findFirstCallback(sortedCallbacks, numberOfSortedCallbacks, searchStart);
+	uint32_t j = findLongCallback(0, numberOfLongCallbacks, 0, address, spanEnd);
+
+	while (true) {
+		const bool sortedLeft = (i < numberOfSortedCallbacks) && (memoryChangeCallbacks[sortedCallbacks[i]].memoryAddress < spanEnd);
+		const bool longLeft = (j < numberOfLongCallbacks);
+
+		if ( (!sortedLeft) && (!longLeft) ) {
+			break;
+		}
+
+		if ( longLeft && ((!sortedLeft) || callbackBefore(longCallbacks[j], sortedCallbacks[i])) ) {
+			markChangedCallback(longCallbacks[j], address, newData, spanEnd);
+			j = findLongCallback(0, numberOfLongCallbacks, j + 1, address, spanEnd);
+		} else {
+			markChangedCallback(sortedCallbacks[i++], address, newData, spanEnd);
+		}
+	}
+}
+
+template <typename Profile>
+inline bool BasicGenericSlave<Profile>::callbackBefore(uint16_t a, uint16_t b) const {
+	const uint32_t addressA = memoryChangeCallbacks[a].memoryAddress;
+	const uint32_t addressB = memoryChangeCallbacks[b].memoryAddress;
+	return (addressA < addressB) || ( (addressA == addressB) && (a < b) );
+}
+
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::buildLongCallbackTree(uint32_t low, uint32_t high) {
+	if (low >= high) {
+		return 0;
+	}
+
+	const uint32_t middle = (low + high) / 2;
+	const MemoryChangeCallback &entry = memoryChangeCallbacks[longCallbacks[middle]];
+	uint32_t last = entry.memoryAddress + (entry.length - 1);
+
+	const uint32_t left = buildLongCallbackTree(low, middle);
+	const uint32_t right = buildLongCallbackTree(middle + 1, high);
+	last = (left > last) ? left : last;
+	last = (right > last) ? right : last;
+
+	longCallbackLast[middle] = last;
+	return last;
+}
+
+template <typename Profile>
+uint32_t BasicGenericSlave<Profile>::findLongCallback(uint32_t low, uint32_t high, uint32_t from, uint32_t address, uint64_t spanEnd) const {
+	if ( (low >= high) || (high <= from) ) {
+		return numberOfLongCallbacks;
+	}
+
+	// Table is sorted by memory address, range starts with its lowest one.
+	const uint32_t middle = (low + high) / 2;
+	if ( (longCallbackLast[middle] < address) || (memoryChangeCallbacks[longCallbacks[low]].memoryAddress >= spanEnd) ) {
+		return numberOfLongCallbacks;
+	}
+
+	const uint32_t found = findLongCallback(low, middle, from, address, spanEnd);
+	if (found != numberOfLongCallbacks) {
+		return found;
+	}
+
+	const MemoryChangeCallback &entry = memoryChangeCallbacks[longCallbacks[middle]];
+	if ( (middle >= from) && (entry.memoryAddress < spanEnd) && (entry.memoryAddress + (entry.length - 1) >= address) ) {
+		return middle;
+	}
+
+	return findLongCallback(middle + 1, high, from, address, spanEnd);
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::markChangedCallback(uint16_t index, uint32_t address, const uint8_t *newData, uint64_t spanEnd) {
+	MemoryChangeCallback &entry = memoryChangeCallbacks[index];
+
+	const uint64_t watchedEnd = (uint64_t)entry.memoryAddress + entry.length;
+	uint32_t first = (entry.memoryAddress > address) ? entry.memoryAddress : address;
+	uint32_t end = (uint32_t)((watchedEnd < spanEnd) ? watchedEnd : spanEnd);
+
+	// Trim unchanged bytes from both sides of overlapping part.
+	while ( (first < end) && (memory[first] == newData[first - address]) ) {
+		first++;
+	}
+	while ( (first < end) && (memory[end - 1] == newData[end - 1 - address]) ) {
+		end--;
+	}
+
+	if (first >= end) {
+		return;
+	}
+
+	if (pendingCallbacks[index]) {
+		entry.changedStart = (first < entry.changedStart) ? first : entry.changedStart;
+		entry.changedEnd = (end > entry.changedEnd) ? end : entry.changedEnd;
+	} else {
+		entry.changedStart = first;
+		entry.changedEnd = end;
+		pendingCallbacks[index] = true;
+		pendingQueue[pendingCount++] = index;
+	}
+}
+
+template <typename Profile>
+void BasicGenericSlave<Profile>::clearPendingCallbacks() {
+	for (uint32_t i = 0; i < pendingCount; i++) {
+		pendingCallbacks[pendingQueue[i]] = false;
+	}
+
+	pendingCount = 0;
+}
+
 MemoryChangeCallback::MemoryChangeCallback():
 	memoryAddress(0),
-	callback(nullptr)
+	length(1),
+	callback(nullptr),
+	rangeCallback(nullptr),
+	context(nullptr),
+	changedStart(0),
+	changedEnd(0)
 {}
+
+// Sequence bits start as if frame with bit 1 was the last one, so the first frame (bit 0) is a new one.
+StreamWindow::StreamWindow():
+	memoryAddress(0),
+	readRing(nullptr),
+	writeRing(nullptr),
+	sentCount(0),
+	readSequence(1),
+	writeSequence(1)
+{}
+
+// Profiles available to slaves, add explicit instantiation here to use another one.
+template class BasicGenericSlave<DefaultProfile>;
+template class BasicGenericSlave<CompactProfile>;
+template class BasicGenericSlave<TinyProfile>;
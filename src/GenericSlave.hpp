@@ -25,23 +25,76 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #include <cstdint>
 
 #include "CommStatus.hpp"
+#include "CommRing.hpp"
 #include "CommChecksum.hpp"
 #include "CommConstants.hpp"
+#include "CommProfile.hpp"
+#include "CommStatistics.hpp"
 
-constexpr uint16_t MAX_MEMORY_CHANGE_CALLBACKS = 10;
+#if EMBEDDEDCOMM_STATS_TIMING && (defined(__linux__) || defined(_WIN32) || defined(__APPLE__))
+#include <chrono>
+#endif
+
+// Maximum number of memory change callbacks, override with -DEMBEDDEDCOMM_MAX_MEMORY_CHANGE_CALLBACKS=N.
+// Cost of a write does not depend on this value, each callback takes about 30 bytes of RAM.
+#ifndef EMBEDDEDCOMM_MAX_MEMORY_CHANGE_CALLBACKS
+#define EMBEDDEDCOMM_MAX_MEMORY_CHANGE_CALLBACKS 10
+#endif
+
+constexpr uint16_t MAX_MEMORY_CHANGE_CALLBACKS = EMBEDDEDCOMM_MAX_MEMORY_CHANGE_CALLBACKS;
+
+// Maximum number of stream windows, override with -DEMBEDDEDCOMM_MAX_STREAM_WINDOWS=N.
+#ifndef EMBEDDEDCOMM_MAX_STREAM_WINDOWS
+#define EMBEDDEDCOMM_MAX_STREAM_WINDOWS 4
+#endif
+
+constexpr uint16_t MAX_STREAM_WINDOWS = EMBEDDEDCOMM_MAX_STREAM_WINDOWS;
+
+// Watched addresses are summarized in bitmap filter with one bit per page (hashed modulo filter size),
+// so writes to unwatched memory are rejected in constant time.
+constexpr uint32_t CALLBACK_FILTER_PAGE_SHIFT = 5; // 32 byte pages.
+constexpr uint32_t CALLBACK_FILTER_WORDS = 8; // 256 bits.
+
+// Callbacks watching longer ranges are kept in separate table indexed by their ends, so search for callbacks
+// overlapping written span steps back at most this many bytes, whatever ranges other callbacks watch.
+constexpr uint32_t LONG_CALLBACK_LENGTH = 1u << CALLBACK_FILTER_PAGE_SHIFT;
 
 using CallbackFunction = void(*)();
 
+// Callback watching memory range. Receives merged span of bytes changed in watched range
+// since previous invocation and user defined context.
+using RangeCallbackFunction = void(*)(uint32_t changedAddress, uint32_t changedLength, void *context);
+
 struct MemoryChangeCallback {
 	MemoryChangeCallback();
 
+	uint32_t memoryAddress; // First watched address.
+	uint32_t length; // Number of watched bytes.
+	CallbackFunction callback; // Used if callback was registered for single address.
+	RangeCallbackFunction rangeCallback;
+	void *context;
+	uint32_t changedStart; // Span [changedStart, changedEnd) of changed bytes, valid if callback is pending.
+	uint32_t changedEnd;
+};
+
+// Addresses backed by rings instead of memory, see addStreamWindow().
+struct StreamWindow {
+	StreamWindow();
+
 	uint32_t memoryAddress;
-	CallbackFunction callback;
+	CommRing *readRing; // Filled by application, drained by master.
+	CommRing *writeRing; // Filled by master, drained by application.
+	uint32_t sentCount; // Stream bytes sent in the last read response, removed once master acknowledges them.
+	uint8_t readSequence; // Sequence bit of the last read.
+	uint8_t writeSequence; // Sequence bit of the last applied write.
 };
 
-class GenericSlave {
+// Profile selects widths of frame header fields and checksum (see CommProfile.hpp), master must use the same one.
+// Implementation is explicitly instantiated in GenericSlave.cpp for profiles defined in CommProfile.hpp.
+template <typename Profile>
+class BasicGenericSlave {
 public:
-	GenericSlave();
+	BasicGenericSlave();
 
 	// Pass pointer to buffer which will be used as memory.
 	void initialize(uint8_t *memory, uint32_t memorySize);
@@ -51,27 +104,96 @@ public:
 	// After memory backups are enabled, maximum write size is restricted by backupBufferSIze
 	void enableMemBackups(uint8_t *backupBuffer, uint32_t backupBufferSize);
 
+	// Enable staged writes: written data is collected in stagingBuffer and copied to memory in one step
+	// once its checksum is verified, so corrupted writes never touch memory and nothing has to be restored.
+	// Maximum write size is restricted by stagingBufferSize. Takes precedence over memory backups.
+	// Buffer may be shared with request buffer of extended frames.
+	void enableStagedWrites(uint8_t *stagingBuffer, uint32_t stagingBufferSize);
+
+	// Enable extended frames (batch, atomic operations) with requests of up to requestBufferSize bytes.
+	// Request is stored in requestBuffer and executed once its checksum is verified,
+	// so corrupted requests do not modify memory. Without request buffer extended frames are rejected, except limits request.
+	void enableExtendedFrames(uint8_t *requestBuffer, uint32_t requestBufferSize);
+
+	// Select encoding of frame headers, master must use the same one (HeaderFixed by default).
+	// Call between transactions.
+	void setHeaderEncoding(HeaderEncoding encoding);
+
 	// Handle received byte according to EmbeddedComm protocol.
 	void writeHandler(uint8_t receivedByte);
 
 	// Handle byte request according to EmbeddedComm protocol. Return byte to send out.
 	uint8_t readHandler();
 
+	// Handle block of received bytes. Header is parsed byte by byte, payload is copied to memory
+	// in one step. Results are identical to calling writeHandler(uint8_t) for every byte.
+	void writeHandler(const uint8_t *receivedBytes, uint32_t size);
+
+	// Fill buffer with size bytes to send out. Payload is copied from memory in one step.
+	// Results are identical to calling readHandler() for every byte.
+	void readHandler(uint8_t *bytesToSend, uint32_t size);
+
 	// Add memory change callback. Returns false if callback cannot be added due to lack of space.
 	// Keep callbacks fast, because slave has busy status if some callbacks await execution.
+	// Pending callbacks are executed in order of their memory addresses.
 	bool addMemoryChangeCallback(uint32_t memoryAddress, CallbackFunction callback);
 
+	// Add callback watching range [memoryAddress, memoryAddress + length). Callback is invoked once per transaction
+	// (in process()) with merged span of changed bytes, context is passed back unchanged.
+	// Returns false if callback cannot be added due to lack of space or length is 0.
+	bool addMemoryChangeCallback(uint32_t memoryAddress, uint32_t length, RangeCallbackFunction callback, void *context = nullptr);
+
+	// Track changed memory pages of pageSize bytes (power of 2), so master can read only pages changed since its
+	// previous dirty map request. dirtyFlags holds one byte per page (at least (memorySize + pageSize - 1) / pageSize),
+	// call after initialize(). All pages start dirty. Returns false if page size or flag buffer is invalid.
+	bool enableDirtyTracking(uint8_t *dirtyFlags, uint32_t numberOfFlags, uint32_t pageSize);
+
+	// Mark pages of range [memoryAddress, memoryAddress + length) as changed. Call after application modifies memory
+	// directly, writes of master are tracked automatically.
+	void markDirty(uint32_t memoryAddress, uint32_t length);
+
+	// Copy data to memory, marking only pages which really change. Use for values rewritten periodically.
+	void writeMemory(uint32_t memoryAddress, const uint8_t *data, uint32_t length);
+
+	// Map STREAM_WINDOW_SIZE addresses starting at memoryAddress to rings. Reading the window pops bytes from readRing,
+	// writing pushes whole frame data into writeRing (or fails with ErrBackupBufferOverflow if it does not fit).
+	// Slave is consumer of readRing and producer of writeRing, application the other side. Either ring may be nullptr,
+	// access in its direction is then rejected. Windows take precedence over memory and are not accessible by
+	// extended frames. Returns false if window cannot be added due to lack of space.
+	bool addStreamWindow(uint32_t memoryAddress, CommRing *readRing, CommRing *writeRing);
+
 	// Need to be called frequentlly, manages potentially time-consuming task (eg. moving data from rBuffer to memory).
 	void process();
 
+#if EMBEDDEDCOMM_STATS
+	// Serve copy of statistics (taken when frame header is received) at sizeof(CommSlaveStatistics) addresses
+	// starting with memoryAddress, master reads them with GenericMaster::readSlaveStatistics(). Window takes
+	// precedence over memory and stream windows, writes to it are rejected with ErrInvalidWrite.
+	void enableStatisticsWindow(uint32_t memoryAddress);
+
+	const CommSlaveStatistics &getStatistics() const;
+
+	void resetStatistics();
+#endif
+
 protected:
 
-	// Method invoked when master sends dataLength and memoryAddress with read flag set.
+	// Method invoked as soon as it is known how many bytes master reads next, for read frames right after
+	// dataLength and memoryAddress are received (nBytes covers data, checksum and status).
 	// Not needed if child class can figure out when to send data on their own, for example i2c protocol
 	// carrries r/w flag itself. Do not do any time consuming operations here.
 	virtual void sendToMaster(uint32_t nBytes) {};
 
+#if EMBEDDEDCOMM_STATS_TIMING
+	// Time in microseconds used by statistics, called from handlers (keep it fast). Host builds use std::chrono,
+	// slave drivers override it with hardware timer. Wraps around.
+	virtual uint32_t getTimeUs();
+#endif
+
 private:
+	// Checksum mode of current frame, known at compile time if profile fixes it.
+	inline ChecksumMode frameChecksumMode() const;
+
 	// Resets internal values to prepare for next transfer
 	void reset();
 
@@ -82,20 +204,202 @@ private:
 
 	void receiveDataLength(uint8_t receivedByte);
 
+	// Incremental decoder of both varint header fields.
+	void receiveVarintHeader(uint8_t receivedByte);
+
+	// Set checksum mode of current frame (reserved values are rejected) and initialize checksum.
+	void selectChecksumMode(uint8_t mode);
+
+	// Called once data length field is decoded (in any header encoding).
+	void dataLengthReceived(bool read, bool extended, uint32_t length);
+
+	// Called once memory address field is decoded, memoryAddress holds its value.
+	void memoryAddressReceived();
+
+	// Window containing given address, nullptr if address belongs to memory.
+	StreamWindow *findStreamWindow(uint32_t address);
+
+	// Prepare access to stream window addressed by current frame.
+	void openStream();
+
+	// Fill bytes of stream read response starting at given offset.
+	void streamResponse(uint8_t *bytes, uint32_t offset, uint32_t size) const;
+
 	void receiveData(uint8_t receivedByte);
 
+	// Copy whole span of payload into memory. Returns false if span cannot be handled at once
+	// (errors occurred or would occur), in that case bytes need to be handled one by one.
+	bool receiveDataBlock(const uint8_t *receivedBytes, uint32_t size);
+
+	// Copy whole span of requested data from memory. Returns false if span cannot be handled at once.
+	bool sendDataBlock(uint8_t *bytesToSend, uint32_t size);
+
+	// Copy verified write from stagingBuffer to memory.
+	void commitStagedWrite();
+
+	// Called when whole request of extended frame was received and its checksum verified.
+	void executeExtendedFrame();
+
+	// Return next byte of response to extended frame.
+	uint8_t nextResponseByte();
+
+	// Check batch request stored in requestBuffer. Returns number of response bytes, or UINT32_MAX if malformed.
+	uint32_t checkBatch() const;
+
+	// Apply writes of verified batch request.
+	void executeBatchWrites();
+
+	uint8_t nextBatchResponseByte();
+
+	// Returns true if read entry at given offset of batch request overlaps write entry following it.
+	bool batchReadOverwritten(uint32_t entryOffset) const;
+
+	// Check atomic request stored in requestBuffer. Returns number of response bytes, or UINT32_MAX if malformed.
+	uint32_t checkAtomic() const;
+
+	// Apply verified atomic request, its response (status and old value) replaces the request.
+	void executeAtomic();
+
+	// Next byte of dirty map response, pages are cleared as they are reported.
+	uint8_t nextDirtyMapByte();
+
+	// Next byte of limits response, fields are little endian.
+	uint8_t nextLimitsByte();
+
+	// Mark pages of range already checked against memory size.
+	inline void markDirtyPages(uint32_t address, uint32_t length);
+
+	// Set Busy flag, noting when slave became busy (statistics builds only).
+	inline void setBusy();
+
+	// Status of batch entry accessing length bytes at address.
+	StatusValue batchEntryStatus(uint32_t address, uint32_t length) const;
+
+	// Returns true if some callback may watch given address (false positives are possible).
+	inline bool callbackFilterHit(uint32_t address) const;
+
+	// Register callback in sorted (or long callbacks) table and page filter.
+	bool insertCallback(const MemoryChangeCallback &callback);
+
+	// Queue callbacks watching addresses in range [address, address + size), which values differ from newData,
+	// and extend their changed spans.
+	void markChangedCallbacks(uint32_t address, const uint8_t *newData, uint32_t size);
+
+	// Queue single callback if it watches bytes of span [address, spanEnd) which values differ from newData.
+	void markChangedCallback(uint16_t index, uint32_t address, const uint8_t *newData, uint64_t spanEnd);
+
+	// Index of the first entry of table (sorted by memory address) with memory address not lower than given one.
+	uint32_t findFirstCallback(const uint16_t *table, uint32_t count, uint32_t address) const;
+
+	// Whether callback a comes before b in sorted tables: by memory address, then by registration order.
+	inline bool callbackBefore(uint16_t a, uint16_t b) const;
+
+	// longCallbacks form implicit binary tree: range [low, high) is rooted at its middle position, which keeps
+	// the highest address watched by the range in longCallbackLast. Rebuild range, returns that address.
+	uint32_t buildLongCallbackTree(uint32_t low, uint32_t high);
+
+	// Position of the first long callback in range [low, high), not lower than from, overlapping span
+	// [address, spanEnd). Returns numberOfLongCallbacks if there is none. Ranges ending below address
+	// or starting at spanEnd or above are skipped whole.
+	uint32_t findLongCallback(uint32_t low, uint32_t high, uint32_t from, uint32_t address, uint64_t spanEnd) const;
+
+	// Drop callbacks awaiting execution.
+	void clearPendingCallbacks();
+
 	uint8_t *memory; // Pointer to device memory reserved for slave's memory.
 	uint8_t *backupBuffer; // Pointer to device memory reserved for slave's receive buffer.
+	uint8_t *requestBuffer; // Requests of extended frames.
+	uint8_t *stagingBuffer; // Data of write transaction awaiting checksum verification.
+	volatile uint8_t *dirtyFlags; // Set by application and slave handlers, cleared when reported to master.
 	MemoryChangeCallback memoryChangeCallbacks[MAX_MEMORY_CHANGE_CALLBACKS];
+	StreamWindow streamWindows[MAX_STREAM_WINDOWS];
+	StreamWindow *stream; // Window accessed by current frame, nullptr if frame accesses memory.
+	uint16_t sortedCallbacks[MAX_MEMORY_CHANGE_CALLBACKS]; // Indexes of memoryChangeCallbacks sorted by memory address.
+	uint16_t longCallbacks[MAX_MEMORY_CHANGE_CALLBACKS]; // The same for callbacks longer than LONG_CALLBACK_LENGTH.
+	uint32_t longCallbackLast[MAX_MEMORY_CHANGE_CALLBACKS]; // See buildLongCallbackTree().
+	uint16_t pendingQueue[MAX_MEMORY_CHANGE_CALLBACKS]; // Indexes of callbacks awaiting execution.
 	bool pendingCallbacks[MAX_MEMORY_CHANGE_CALLBACKS];
+	uint32_t callbackFilter[CALLBACK_FILTER_WORDS];
 	uint32_t backupBufferSize; // Bytes
+	uint32_t requestBufferSize; // Bytes
+	uint32_t stagingBufferSize; // Bytes
 	uint32_t memorySize; // Bytes
 	uint32_t currentNumberOfMemoryChangeCallbacks;
+	uint32_t numberOfSortedCallbacks; // Callbacks in sortedCallbacks.
+	uint32_t numberOfLongCallbacks; // Callbacks in longCallbacks.
+	uint32_t pendingCount; // Number of callbacks in pendingQueue.
+	uint32_t maxCallbackLength; // Longest range in sortedCallbacks, limits search for callbacks overlapping written span.
+	uint32_t numberOfStreamWindows;
+	uint32_t numberOfPages; // Pages tracked by dirtyFlags.
+	uint32_t pageShift; // log2 of page size.
 	volatile uint32_t memoryAddress; // Current memory address used for write/read operations.
 	volatile uint32_t dataLength;
 	volatile uint32_t byteCounter; // Helper value used during reads and writes to keep track of number of bytes.
-	volatile uint8_t checksum;
+	volatile uint32_t backedUpLength; // Bytes of memory saved in backupBuffer by current frame, restored if it fails.
+	volatile uint32_t checksum; // Raw (not finalized) checksum of current frame.
+	volatile uint32_t receivedChecksum;
+	volatile uint32_t responseLength; // Size of response to extended frame declared by master.
+	volatile uint32_t responseCursor; // Offset in requestBuffer of batch entry being answered.
+	volatile uint32_t responseEntryByte; // Number of response bytes already sent for that entry.
+	volatile StatusValue responseEntryStatus; // Status of that entry, evaluated with its first response byte.
+	volatile uint32_t headerSize; // Size of current frame header, upper bound until varint header is decoded.
+	volatile uint32_t lengthFieldSize; // Size of varint data length field, 0 until it is decoded.
+	volatile uint32_t streamCount; // Stream bytes in response to current read.
+	volatile bool streamRepeated; // Current frame repeats the previous one.
+	volatile ChecksumMode checksumMode; // Checksum mode requested by master in current frame.
+	volatile HeaderEncoding headerEncoding;
 	volatile StatusValue statusValue;
 	volatile bool restoreBackupPending;
 	volatile bool readMode;
+	volatile bool extendedFrame;
+	volatile bool statusFrame; // Current frame consists of data length field only.
+	volatile bool readyPending; // Status frame waits until slave is not Busy.
+#if EMBEDDEDCOMM_STATS
+	CommSlaveStatistics statistics;
+	CommSlaveStatistics statisticsSnapshot; // Copy served to master by current frame.
+	uint32_t statisticsWindow; // Address of statistics window.
+	bool statisticsWindowEnabled;
+	volatile bool statisticsFrame; // Current frame reads statistics window.
+#endif
+#if EMBEDDEDCOMM_STATS_TIMING
+	uint32_t busySince; // Time slave became Busy.
+#endif
 };
+
+template <typename Profile>
+inline ChecksumMode BasicGenericSlave<Profile>::frameChecksumMode() const {
+	if constexpr (Profile::CHECKSUM_IN_HEADER) {
+		return checksumMode;
+	} else {
+		return Profile::CHECKSUM_MODE;
+	}
+}
+
+template <typename Profile>
+inline void BasicGenericSlave<Profile>::setBusy() {
+#if EMBEDDEDCOMM_STATS_TIMING
+	if (!(statusValue & Busy)) {
+		busySince = getTimeUs();
+	}
+#endif
+	setStatusValueFlag(Busy, &statusValue);
+}
+
+template <typename Profile>
+inline void BasicGenericSlave<Profile>::markDirtyPages(uint32_t address, uint32_t length) {
+	if ( (dirtyFlags == nullptr) || (length == 0) ) {
+		return;
+	}
+
+	const uint32_t lastPage = (address + (length - 1)) >> pageShift;
+	for (uint32_t page = address >> pageShift; page <= lastPage; page++) {
+		dirtyFlags[page] = 1;
+	}
+}
+
+extern template class BasicGenericSlave<DefaultProfile>;
+extern template class BasicGenericSlave<CompactProfile>;
+extern template class BasicGenericSlave<TinyProfile>;
+
+// Slave using original frame layout.
+using GenericSlave = BasicGenericSlave<DefaultProfile>;
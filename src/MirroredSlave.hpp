@@ -0,0 +1,451 @@
+/*
+MirroredSlave.hpp
+
+MirroredSlave class keeps host-side image of slave's memory region, so reads of many threads
+are served from it while fresh. Host only (requires std::thread).
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "GenericMaster.hpp"
+
+// Counters since object creation.
+struct MirrorStatistics {
+	uint64_t reads; // Calls of read().
+	uint64_t cachedReads; // Reads served from image without waiting for slave.
+	uint64_t transfers; // Read, write and dirty map transactions sent to slave.
+};
+
+// Image is divided into lines of lineSize bytes, freshness is tracked per line. Line is fresh if it was fetched
+// within its TTL, or after the read asking for it started (so concurrent readers share one transfer even with
+// zero TTL). With dirty tracking enabled, lines stay fresh until slave reports their pages changed instead.
+//
+// Only one transaction of the mirror runs at a time, as masters do not allow concurrent transfers to one slave.
+// Lines missed by all threads while a transaction runs are fetched by the next one together, adjacent lines
+// (and lines separated by at most setMergeGap() bytes) with a single read.
+template <typename slaveInfo, typename Profile = DefaultProfile>
+class MirroredSlave {
+public:
+	// Mirror size bytes of slave's memory starting with memoryAddress. All lines start stale, with zero TTL.
+	MirroredSlave(GenericMaster<slaveInfo, Profile> &master, const slaveInfo &slave, uint32_t memoryAddress, uint32_t size, uint32_t lineSize = 16);
+
+	// Set TTL of lines overlapping given range.
+	void setTtl(uint32_t memoryAddress, uint32_t length, std::chrono::microseconds ttl);
+
+	// Check slave's dirty map (see GenericSlave::enableDirtyTracking(), pageSize must match) at most once
+	// per pollInterval before serving reads, lines of changed pages are fetched again. TTLs are not used then.
+	void enableDirtyTracking(uint32_t pageSize, std::chrono::microseconds pollInterval);
+
+	// Fresh bytes between two missed ranges are read as well, if there are at most gap of them. Default is 0.
+	void setMergeGap(uint32_t gap);
+
+	// Copy length bytes starting with memoryAddress into buffer, fetching stale lines from slave.
+	// Returns Ok, status of failed transfer of a line, or ErrMemoryOutOfRange if range is outside image.
+	StatusValue read(uint32_t memoryAddress, uint8_t *buffer, uint32_t length);
+
+	// Write through to slave. Image is updated if write succeeded, written lines are invalidated otherwise.
+	StatusValue write(uint32_t memoryAddress, uint8_t *data, uint32_t length);
+
+	// Mark lines overlapping given range stale, eg. after slave was reset.
+	void invalidate(uint32_t memoryAddress, uint32_t length);
+
+	MirrorStatistics getStatistics() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	enum LineState : uint8_t {
+		LineIdle,
+		LinePending, // Requested by reader, fetched by next transaction.
+		LineFetching
+	};
+
+	struct Line {
+		Clock::time_point fetchedAt; // Start of transaction which fetched the line.
+		Clock::time_point failedAt; // Start of the last transaction which failed to fetch it.
+		std::chrono::microseconds ttl;
+		StatusValue status; // Status of the last fetch.
+		LineState state;
+		bool valid;
+	};
+
+	// Lines overlapping range, range must be inside image.
+	uint32_t firstLine(uint32_t memoryAddress) const;
+	uint32_t lastLine(uint32_t memoryAddress, uint32_t length) const;
+
+	bool inImage(uint32_t memoryAddress, uint32_t length) const;
+	bool fresh(const Line &line, Clock::time_point now, Clock::time_point requestStart) const;
+
+	// Fetch all pending lines. Requires mutex, released during transfers.
+	void fetchPending(std::unique_lock<std::mutex> &lock);
+
+	// Read dirty map of image and invalidate changed lines. Requires mutex, released during transfers.
+	void pollDirtyMap(std::unique_lock<std::mutex> &lock);
+
+	GenericMaster<slaveInfo, Profile> &master;
+	slaveInfo slave;
+	const uint32_t baseAddress;
+	const uint32_t lineSize;
+	std::vector<uint8_t> image;
+	std::vector<Line> lines;
+
+	mutable std::mutex mutex;
+	std::condition_variable transferFinished;
+	MirrorStatistics statistics;
+	Clock::time_point lastDirtyPoll; // Start of the last dirty map transaction.
+	std::chrono::microseconds dirtyPollInterval;
+	uint32_t pageSize; // Zero if dirty tracking is disabled.
+	uint32_t mergeGap;
+	uint32_t pendingLines;
+	bool transferRunning;
+};
+
+template <typename slaveInfo, typename Profile>
+MirroredSlave<slaveInfo, Profile>::MirroredSlave(GenericMaster<slaveInfo, Profile> &master, const slaveInfo &slave, uint32_t memoryAddress, uint32_t size, uint32_t lineSize):
+	master(master),
+	slave(slave),
+	baseAddress(memoryAddress),
+	lineSize((lineSize == 0) ? 1 : lineSize),
+	image(size),
+	lines((size + this->lineSize - 1) / this->lineSize, Line{Clock::time_point(), Clock::time_point(), std::chrono::microseconds(0), NotUsed, LineIdle, false}),
+	statistics(),
+	lastDirtyPoll(),
+	dirtyPollInterval(0),
+	pageSize(0),
+	mergeGap(0),
+	pendingLines(0),
+	transferRunning(false)
+{}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::setTtl(uint32_t memoryAddress, uint32_t length, std::chrono::microseconds ttl) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!inImage(memoryAddress, length)) {
+		return;
+	}
+
+	for (uint32_t i = firstLine(memoryAddress); i <= lastLine(memoryAddress, length); i++) {
+		lines[i].ttl = ttl;
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::enableDirtyTracking(uint32_t pageSize, std::chrono::microseconds pollInterval) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->pageSize = pageSize;
+	dirtyPollInterval = pollInterval;
+	lastDirtyPoll = Clock::time_point();
+}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::setMergeGap(uint32_t gap) {
+	std::lock_guard<std::mutex> lock(mutex);
+	mergeGap = gap;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue MirroredSlave<slaveInfo, Profile>::read(uint32_t memoryAddress, uint8_t *buffer, uint32_t length) {
+	std::unique_lock<std::mutex> lock(mutex);
+	const Clock::time_point requestStart = Clock::now();
+
+	statistics.reads++;
+
+	if (!inImage(memoryAddress, length)) {
+		return ErrMemoryOutOfRange;
+	}
+	if (length == 0) {
+		statistics.cachedReads++;
+		return Ok;
+	}
+
+	const uint32_t first = firstLine(memoryAddress);
+	const uint32_t last = lastLine(memoryAddress, length);
+	bool waited = false;
+
+	while (true) {
+		// Dirty map is due if it was not checked within interval, nor after this read started.
+		if ( (pageSize != 0) && (lastDirtyPoll < requestStart) && (requestStart - lastDirtyPoll >= dirtyPollInterval) ) {
+			if (transferRunning) {
+				transferFinished.wait(lock);
+			} else {
+				pollDirtyMap(lock);
+			}
+			waited = true;
+			continue;
+		}
+
+		const Clock::time_point now = Clock::now();
+		bool missing = false;
+
+		for (uint32_t i = first; i <= last; i++) {
+			Line &line = lines[i];
+
+			if ( (line.state == LineIdle) && fresh(line, now, requestStart) ) {
+				continue;
+			}
+
+			// Line this read asked for failed in a transaction started since.
+			if ( (line.state == LineIdle) && (!line.valid) && (line.status != Ok) && (line.failedAt >= requestStart) ) {
+				return line.status;
+			}
+
+			if (line.state == LineIdle) {
+				line.state = LinePending;
+				pendingLines++;
+			}
+			missing = true;
+		}
+
+		if (!missing) {
+			break;
+		}
+
+		if (transferRunning) {
+			transferFinished.wait(lock);
+		} else {
+			fetchPending(lock);
+		}
+		waited = true;
+	}
+
+	if (!waited) {
+		statistics.cachedReads++;
+	}
+
+	memcpy(buffer, &image[memoryAddress - baseAddress], length);
+	return Ok;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue MirroredSlave<slaveInfo, Profile>::write(uint32_t memoryAddress, uint8_t *data, uint32_t length) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (!inImage(memoryAddress, length)) {
+		return ErrMemoryOutOfRange;
+	}
+
+	transferFinished.wait(lock, [this] { return !transferRunning; });
+	transferRunning = true;
+	statistics.transfers++;
+
+	lock.unlock();
+	const Clock::time_point start = Clock::now();
+	StatusValue status = master.write(slave, memoryAddress, data, length);
+	lock.lock();
+
+	if (length > 0) {
+		const uint32_t offset = memoryAddress - baseAddress;
+		const uint32_t first = firstLine(memoryAddress);
+		const uint32_t last = lastLine(memoryAddress, length);
+
+		if (status == Ok) {
+			memcpy(&image[offset], data, length);
+		}
+
+		for (uint32_t i = first; i <= last; i++) {
+			const uint32_t lineEnd = ((i + 1) * lineSize < image.size()) ? (i + 1) * lineSize : image.size();
+			const bool covered = (i * lineSize >= offset) && (lineEnd <= offset + length);
+
+			// Partially written line stays as fresh as it was, fully written one is known exactly.
+			if (status != Ok) {
+				lines[i].valid = false;
+			} else if (covered) {
+				lines[i].valid = true;
+				lines[i].fetchedAt = start;
+			}
+		}
+	}
+
+	transferRunning = false;
+	lock.unlock();
+	transferFinished.notify_all();
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::invalidate(uint32_t memoryAddress, uint32_t length) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if ( (!inImage(memoryAddress, length)) || (length == 0) ) {
+		return;
+	}
+
+	for (uint32_t i = firstLine(memoryAddress); i <= lastLine(memoryAddress, length); i++) {
+		lines[i].valid = false;
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+MirrorStatistics MirroredSlave<slaveInfo, Profile>::getStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return statistics;
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t MirroredSlave<slaveInfo, Profile>::firstLine(uint32_t memoryAddress) const {
+	return (memoryAddress - baseAddress) / lineSize;
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t MirroredSlave<slaveInfo, Profile>::lastLine(uint32_t memoryAddress, uint32_t length) const {
+	return (memoryAddress - baseAddress + length - 1) / lineSize;
+}
+
+template <typename slaveInfo, typename Profile>
+bool MirroredSlave<slaveInfo, Profile>::inImage(uint32_t memoryAddress, uint32_t length) const {
+	return (memoryAddress >= baseAddress) && (memoryAddress - baseAddress <= image.size()) &&
+		(length <= image.size() - (memoryAddress - baseAddress));
+}
+
+template <typename slaveInfo, typename Profile>
+bool MirroredSlave<slaveInfo, Profile>::fresh(const Line &line, Clock::time_point now, Clock::time_point requestStart) const {
+	if (!line.valid) {
+		return false;
+	}
+
+	return (pageSize != 0) || (line.fetchedAt >= requestStart) || (now - line.fetchedAt <= line.ttl);
+}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::fetchPending(std::unique_lock<std::mutex> &lock) {
+	struct Run {
+		uint32_t firstLine;
+		uint32_t lastLine;
+	};
+
+	transferRunning = true;
+	const Clock::time_point start = Clock::now();
+
+	// Merge pending lines into runs, short gaps of other lines are fetched with them.
+	std::vector<Run> runs;
+	const uint32_t gapLines = mergeGap / lineSize;
+
+	for (uint32_t i = 0; (i < lines.size()) && (pendingLines > 0); i++) {
+		if (lines[i].state != LinePending) {
+			continue;
+		}
+		pendingLines--;
+
+		if ( (!runs.empty()) && (i - runs.back().lastLine - 1 <= gapLines) ) {
+			runs.back().lastLine = i;
+		} else {
+			runs.push_back({i, i});
+		}
+	}
+
+	for (const Run &run : runs) {
+		for (uint32_t i = run.firstLine; i <= run.lastLine; i++) {
+			lines[i].state = LineFetching;
+		}
+	}
+
+	// Data is read outside image, so readers of other lines are not blocked meanwhile.
+	std::vector<uint8_t> data;
+	std::vector<StatusValue> statuses(runs.size());
+	lock.unlock();
+
+	for (uint32_t r = 0; r < runs.size(); r++) {
+		const uint32_t offset = runs[r].firstLine * lineSize;
+		const uint32_t end = ((runs[r].lastLine + 1) * lineSize < image.size()) ? (runs[r].lastLine + 1) * lineSize : image.size();
+		data.resize(end - offset);
+
+		// Runs longer than a frame can carry are split.
+		statuses[r] = Ok;
+		for (uint32_t done = 0; (done < data.size()) && (statuses[r] == Ok); ) {
+			const uint32_t n = (data.size() - done < Profile::DATA_LENGTH_MASK) ? (data.size() - done) : Profile::DATA_LENGTH_MASK;
+			statuses[r] = master.read(slave, baseAddress + offset + done, &data[done], n);
+			done += n;
+
+			std::lock_guard<std::mutex> statisticsLock(mutex);
+			statistics.transfers++;
+		}
+
+		if (statuses[r] == Ok) {
+			std::lock_guard<std::mutex> imageLock(mutex);
+			memcpy(&image[offset], data.data(), data.size());
+		}
+	}
+
+	lock.lock();
+
+	for (uint32_t r = 0; r < runs.size(); r++) {
+		for (uint32_t i = runs[r].firstLine; i <= runs[r].lastLine; i++) {
+			Line &line = lines[i];
+
+			line.state = LineIdle;
+			line.status = statuses[r];
+			line.valid = (statuses[r] == Ok);
+			if (line.valid) {
+				line.fetchedAt = start;
+			} else {
+				line.failedAt = start;
+			}
+		}
+	}
+
+	transferRunning = false;
+	transferFinished.notify_all();
+}
+
+template <typename slaveInfo, typename Profile>
+void MirroredSlave<slaveInfo, Profile>::pollDirtyMap(std::unique_lock<std::mutex> &lock) {
+	transferRunning = true;
+	lastDirtyPoll = Clock::now();
+
+	const uint32_t firstPage = baseAddress / pageSize;
+	const uint32_t numberOfPages = (baseAddress + image.size() - 1) / pageSize - firstPage + 1;
+	const uint32_t maxPages = (Profile::MAX_EXTENDED_RESPONSE_SIZE < UINT32_MAX / 8) ? Profile::MAX_EXTENDED_RESPONSE_SIZE * 8 : UINT32_MAX;
+
+	std::vector<uint8_t> bitmap((numberOfPages + 7) / 8);
+	StatusValue status = Ok;
+	lock.unlock();
+
+	for (uint32_t done = 0; (done < numberOfPages) && (status == Ok); ) {
+		const uint32_t n = (numberOfPages - done < maxPages) ? (numberOfPages - done) : maxPages;
+		status = master.readDirtyMap(slave, firstPage + done, n, &bitmap[done / 8]);
+		done += n;
+
+		std::lock_guard<std::mutex> statisticsLock(mutex);
+		statistics.transfers++;
+	}
+
+	lock.lock();
+
+	// Lost map may have held changes, so nothing can be trusted then.
+	for (uint32_t page = 0; page < numberOfPages; page++) {
+		if ( (status == Ok) && !(bitmap[page / 8] & (1u << (page % 8))) ) {
+			continue;
+		}
+
+		const uint64_t pageStart = (uint64_t)(firstPage + page) * pageSize;
+		const uint32_t start = (pageStart > baseAddress) ? (uint32_t)(pageStart - baseAddress) : 0;
+		const uint32_t end = (pageStart + pageSize - baseAddress < image.size()) ? (uint32_t)(pageStart + pageSize - baseAddress) : image.size();
+
+		for (uint32_t i = start / lineSize; i <= (end - 1) / lineSize; i++) {
+			lines[i].valid = false;
+		}
+	}
+
+	transferRunning = false;
+	transferFinished.notify_all();
+}
@@ -0,0 +1,438 @@
+/*
+PollGroup.hpp
+
+PollGroup class periodically reads set of memory regions from many slaves, using pool of worker threads.
+Host only (requires std::thread).
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GenericMaster.hpp"
+
+// Result of one poll cycle.
+struct PollCycle {
+	uint64_t number; // Cycles are numbered from 0.
+	uint32_t completedEntries; // Entries read with Ok status.
+	uint32_t failedEntries;
+	std::chrono::steady_clock::time_point scheduledStart;
+	std::chrono::microseconds duration; // From scheduled start to completion of the last entry.
+	bool deadlineMissed; // Cycle did not finish within poll period.
+};
+
+// Counters since start().
+struct PollStatistics {
+	uint64_t cycles;
+	uint64_t deadlineMisses; // Cycles which did not finish within period.
+	uint64_t skippedCycles; // Cycles not started, because previous one was still running.
+};
+
+using PollCycleCallback = std::function<void(const PollCycle &cycle)>;
+
+// Regions are grouped in lanes. Lane is executed by one worker at a time, entry by entry, different lanes
+// are executed concurrently. By default every slave has own lane; slaves sharing bus that cannot carry
+// concurrent transfers (eg. I2C) should be put in one lane explicitly.
+template <typename slaveInfo, typename Profile = DefaultProfile>
+class PollGroup {
+public:
+	// Master must allow concurrent transfers to different lanes (eg. linuxMasterUSB to different devices).
+	PollGroup(GenericMaster<slaveInfo, Profile> &master, uint32_t numberOfWorkers);
+	~PollGroup();
+
+	// Add region of length bytes at memoryAddress read into buffer every cycle. Returns entry index.
+	// Entries can only be added while group is stopped.
+	uint32_t add(const slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t length);
+
+	// Same as above, but with explicitly chosen lane (any number, lanes are matched by value).
+	uint32_t add(const slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t length, uint32_t lane);
+
+	// Consecutive entries of the same slave in a lane are read with batch frames (slave needs extended frames enabled).
+	// Can only be changed while group is stopped.
+	void setBatching(bool enabled);
+
+	// Callback invoked from worker thread after each cycle.
+	void setCycleCallback(PollCycleCallback callback);
+
+	// Start polling every period. Cycles never overlap, if previous cycle did not finish, next one is skipped.
+	void start(std::chrono::microseconds period);
+
+	// Stop polling, waits for running cycle.
+	void stop();
+
+	// Execute single cycle and wait for it, group must be stopped.
+	PollCycle runCycle();
+
+	// Status of entry from last cycle in which it was read.
+	StatusValue getStatus(uint32_t entry) const;
+
+	PollStatistics getStatistics() const;
+
+private:
+	struct Entry {
+		slaveInfo slave;
+		uint32_t memoryAddress;
+		uint8_t *buffer;
+		uint32_t length;
+		StatusValue status;
+	};
+
+	struct Lane {
+		uint32_t id;
+		std::vector<uint32_t> entries;
+	};
+
+	void worker();
+
+	// Run all entries of lane. Returns number of entries read with Ok status.
+	uint32_t executeLane(Lane &lane);
+
+	// Read entries [first, last) of lane, all of the same slave, with batch frames.
+	uint32_t executeBatches(Lane &lane, uint32_t first, uint32_t last);
+
+	// Store status of entry read by worker, getStatus() may read it from other thread. Returns true if Ok.
+	bool storeStatus(Entry &entry, StatusValue status);
+
+	// Queue all lanes. Requires mutex.
+	void beginCycle(std::chrono::steady_clock::time_point scheduledStart);
+
+	void timer();
+
+	GenericMaster<slaveInfo, Profile> &master;
+	std::vector<Entry> entries;
+	std::vector<Lane> lanes;
+	std::vector<std::thread> workers;
+	std::thread timerThread;
+
+	mutable std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable cycleFinished;
+	std::deque<Lane*> queue;
+	PollCycleCallback callback;
+	std::chrono::microseconds period;
+	PollCycle cycle; // Cycle in progress, or last one.
+	PollStatistics statistics;
+	uint32_t remainingLanes;
+	uint32_t nextAutoLane;
+	bool cycleRunning;
+	bool running;
+	bool batching;
+	bool shutdown;
+};
+
+template <typename slaveInfo, typename Profile>
+PollGroup<slaveInfo, Profile>::PollGroup(GenericMaster<slaveInfo, Profile> &master, uint32_t numberOfWorkers):
+	master(master),
+	period(0),
+	cycle(),
+	statistics(),
+	remainingLanes(0),
+	nextAutoLane(0x80000000u),
+	cycleRunning(false),
+	running(false),
+	batching(false),
+	shutdown(false)
+{
+	if (numberOfWorkers == 0) {
+		numberOfWorkers = 1;
+	}
+
+	for (uint32_t i = 0; i < numberOfWorkers; i++) {
+		workers.emplace_back(&PollGroup::worker, this);
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+PollGroup<slaveInfo, Profile>::~PollGroup() {
+	stop();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+	}
+	workAvailable.notify_all();
+
+	for (std::thread &thread : workers) {
+		thread.join();
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t PollGroup<slaveInfo, Profile>::add(const slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t length) {
+	uint32_t lane = nextAutoLane;
+
+	{
+		// Reuse lane of the same slave, automatic lane ids start high to not collide with usual explicit ones.
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const Lane &existing : lanes) {
+			for (uint32_t index : existing.entries) {
+				if (entries[index].slave == slave) {
+					lane = existing.id;
+				}
+			}
+		}
+
+		if (lane == nextAutoLane) {
+			nextAutoLane++;
+		}
+	}
+
+	return add(slave, memoryAddress, buffer, length, lane);
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t PollGroup<slaveInfo, Profile>::add(const slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t length, uint32_t lane) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const uint32_t index = entries.size();
+	entries.push_back({slave, memoryAddress, buffer, length, NotUsed});
+
+	for (Lane &existing : lanes) {
+		if (existing.id == lane) {
+			existing.entries.push_back(index);
+			return index;
+		}
+	}
+
+	lanes.push_back({lane, {index}});
+	return index;
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::setBatching(bool enabled) {
+	std::lock_guard<std::mutex> lock(mutex);
+	batching = enabled;
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::setCycleCallback(PollCycleCallback callback) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->callback = callback;
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::start(std::chrono::microseconds period) {
+	stop();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	this->period = period;
+	statistics = PollStatistics();
+	running = true;
+	timerThread = std::thread(&PollGroup::timer, this);
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	cycleFinished.notify_all();
+
+	if (timerThread.joinable()) {
+		timerThread.join();
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	cycleFinished.wait(lock, [this] { return !cycleRunning; });
+}
+
+template <typename slaveInfo, typename Profile>
+PollCycle PollGroup<slaveInfo, Profile>::runCycle() {
+	std::unique_lock<std::mutex> lock(mutex);
+	cycleFinished.wait(lock, [this] { return !cycleRunning; });
+
+	beginCycle(std::chrono::steady_clock::now());
+	cycleFinished.wait(lock, [this] { return !cycleRunning; });
+
+	return cycle;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue PollGroup<slaveInfo, Profile>::getStatus(uint32_t entry) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return (entry < entries.size()) ? entries[entry].status : NotUsed;
+}
+
+template <typename slaveInfo, typename Profile>
+PollStatistics PollGroup<slaveInfo, Profile>::getStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return statistics;
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::beginCycle(std::chrono::steady_clock::time_point scheduledStart) {
+	cycle.number = statistics.cycles++;
+	cycle.completedEntries = 0;
+	cycle.failedEntries = 0;
+	cycle.scheduledStart = scheduledStart;
+	cycle.duration = std::chrono::microseconds(0);
+	cycle.deadlineMissed = false;
+
+	if (lanes.empty()) {
+		cycleRunning = false;
+		cycleFinished.notify_all();
+		return;
+	}
+
+	cycleRunning = true;
+	remainingLanes = lanes.size();
+	for (Lane &lane : lanes) {
+		queue.push_back(&lane);
+	}
+
+	workAvailable.notify_all();
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::timer() {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto next = std::chrono::steady_clock::now();
+
+	while (running) {
+		if (cycleRunning) {
+			statistics.skippedCycles++;
+		} else {
+			beginCycle(next);
+		}
+
+		next += period;
+		cycleFinished.wait_until(lock, next, [this] { return !running; });
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+void PollGroup<slaveInfo, Profile>::worker() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		workAvailable.wait(lock, [this] { return shutdown || !queue.empty(); });
+		if (shutdown) {
+			return;
+		}
+
+		Lane *lane = queue.front();
+		queue.pop_front();
+
+		lock.unlock();
+		uint32_t completed = executeLane(*lane);
+		lock.lock();
+
+		cycle.completedEntries += completed;
+		cycle.failedEntries += lane->entries.size() - completed;
+
+		if (--remainingLanes > 0) {
+			continue;
+		}
+
+		// Last lane of the cycle.
+		cycle.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - cycle.scheduledStart);
+		cycle.deadlineMissed = running && (cycle.duration > period);
+		if (cycle.deadlineMissed) {
+			statistics.deadlineMisses++;
+		}
+
+		PollCycle finished = cycle;
+		PollCycleCallback finishedCallback = callback;
+
+		lock.unlock();
+		if (finishedCallback) {
+			finishedCallback(finished);
+		}
+		lock.lock();
+
+		cycleRunning = false;
+		cycleFinished.notify_all();
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t PollGroup<slaveInfo, Profile>::executeLane(Lane &lane) {
+	uint32_t completed = 0;
+
+	for (uint32_t i = 0; i < lane.entries.size(); i++) {
+		Entry &entry = entries[lane.entries[i]];
+
+		if (batching) {
+			// Consecutive entries of the same slave share batch frames.
+			uint32_t last = i + 1;
+			while ( (last < lane.entries.size()) && (entries[lane.entries[last]].slave == entry.slave) ) {
+				last++;
+			}
+
+			completed += executeBatches(lane, i, last);
+			i = last - 1;
+			continue;
+		}
+
+		if (storeStatus(entry, master.read(entry.slave, entry.memoryAddress, entry.buffer, entry.length))) {
+			completed++;
+		}
+	}
+
+	return completed;
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t PollGroup<slaveInfo, Profile>::executeBatches(Lane &lane, uint32_t first, uint32_t last) {
+	uint32_t completed = 0;
+	CommBatch batch;
+
+	uint32_t i = first;
+	while (i < last) {
+		// Fill batch with as many entries as fits.
+		const uint32_t batchStart = i;
+		batch.clear();
+		while (i < last) {
+			Entry &entry = entries[lane.entries[i]];
+			if ( (entry.length > UINT16_MAX) || !batch.read(entry.memoryAddress, entry.buffer, entry.length) ) {
+				break;
+			}
+			i++;
+		}
+
+		if (batch.size() == 0) {
+			// Entry too large for batch frame, read it alone.
+			Entry &entry = entries[lane.entries[i++]];
+			completed += storeStatus(entry, master.read(entry.slave, entry.memoryAddress, entry.buffer, entry.length));
+			continue;
+		}
+
+		master.execute(entries[lane.entries[batchStart]].slave, batch);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (uint32_t j = 0; j < batch.size(); j++) {
+			Entry &entry = entries[lane.entries[batchStart + j]];
+			entry.status = batch.getStatus(j);
+			completed += (entry.status == Ok);
+		}
+	}
+
+	return completed;
+}
+
+template <typename slaveInfo, typename Profile>
+bool PollGroup<slaveInfo, Profile>::storeStatus(Entry &entry, StatusValue status) {
+	std::lock_guard<std::mutex> lock(mutex);
+	entry.status = status;
+	return (status == Ok);
+}
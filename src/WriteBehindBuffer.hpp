@@ -0,0 +1,365 @@
+/*
+WriteBehindBuffer.hpp
+
+WriteBehindBuffer class collects small writes to one slave and sends adjacent and overlapping ones
+merged into single frames. Host only (requires std::mutex and std::function).
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "GenericMaster.hpp"
+
+// Called with status of the frame which carried the write.
+using WriteCallback = std::function<void(StatusValue status)>;
+
+// Counters since object creation.
+struct WriteBehindStatistics {
+	uint64_t writes; // Calls of write().
+	uint64_t frames; // Write frames sent to slave.
+	uint64_t bytes; // Data bytes sent to slave.
+};
+
+// Ordering guarantees:
+// 1. Bytes of later write replace bytes of earlier pending one at the same address, slave ends with
+//    the same contents as if writes were sent in call order.
+// 2. Pending writes are sent only when flushed, spans in ascending address order. Writes to separate
+//    (not adjacent) ranges may therefore reach slave in different order than they were issued,
+//    call flush() between writes whose order matters.
+// 3. Span is sent in one frame, so writes merged into it are applied together or not at all.
+// 4. read() flushes pending writes overlapping read range first, so it sees them. Other pending writes
+//    are not flushed, reads bypassing the buffer do not see any of them.
+// 5. flush() is a barrier: when it returns, every write queued before was sent and its callback called,
+//    also when another thread sent it and still runs callbacks. flush() called from a callback only waits
+//    until writes are sent, as that callback has not returned yet.
+// 6. Failed span is not repeated, all its callbacks get failed status. Later writes are not held back.
+//
+// Callbacks are called from the thread which caused the flush, after buffer is unlocked,
+// so they may queue further writes.
+template <typename slaveInfo, typename Profile = DefaultProfile>
+class WriteBehindBuffer {
+public:
+	WriteBehindBuffer(GenericMaster<slaveInfo, Profile> &master, const slaveInfo &slave);
+
+	// Flush all pending writes when they hold at least maxPendingBytes bytes, or when the oldest one
+	// waits for maxDelay (zero disables, checked by write(), read() and process()). Defaults: 256 bytes, no delay limit.
+	void setThresholds(uint32_t maxPendingBytes, std::chrono::microseconds maxDelay);
+
+	// Longest merged frame, set to slave's backup or staging buffer size if it has one. Default is 64 bytes.
+	void setMaxSpanSize(uint32_t size);
+
+	// Queue write, data is copied. Returns Ok, or ErrMemoryOutOfRange if write cannot be sent at all.
+	// Write longer than span limit is sent at once, after pending writes it overlaps.
+	StatusValue write(uint32_t memoryAddress, const uint8_t *data, uint32_t length, WriteCallback callback = WriteCallback());
+
+	// Send all pending writes. Returns Ok, or status of the first failed frame.
+	StatusValue flush();
+
+	// Read from slave, sending pending writes overlapping the range first. Returns status of failed frame, or of read.
+	StatusValue read(uint32_t memoryAddress, uint8_t *buffer, uint32_t length);
+
+	// Flush if the oldest pending write waits for maxDelay. Call periodically when delay limit is set.
+	void process();
+
+	// Number of bytes waiting to be sent.
+	uint32_t getPendingBytes() const;
+
+	WriteBehindStatistics getStatistics() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+	using Completions = std::vector<std::pair<WriteCallback, StatusValue>>;
+
+	struct Span {
+		uint32_t memoryAddress;
+		std::vector<uint8_t> data;
+		std::vector<WriteCallback> callbacks;
+		Clock::time_point queuedAt; // Of the oldest write merged into span.
+	};
+
+	// Send spans [first, last) and remove them. Requires mutex. Returns Ok or status of the first failed frame.
+	StatusValue flushSpans(uint32_t first, uint32_t last, Completions &completions);
+
+	// Send all spans if thresholds are exceeded. Requires mutex.
+	void checkThresholds(Completions &completions);
+
+	// Unlock and call callbacks, then mark them finished for flush().
+	void complete(std::unique_lock<std::mutex> &lock, Completions &completions);
+
+	GenericMaster<slaveInfo, Profile> &master;
+	slaveInfo slave;
+	std::vector<Span> spans; // Sorted by address, neither overlapping nor adjacent.
+
+	mutable std::mutex mutex; // Held during transfers, so only one transaction to slave runs at a time.
+	std::condition_variable completionsFinished;
+	uint32_t runningCompletions; // Threads calling callbacks of sent writes.
+	static thread_local uint32_t callbackDepth; // Callbacks of buffers of this type being called by this thread.
+	WriteBehindStatistics statistics;
+	std::chrono::microseconds maxDelay;
+	uint32_t maxPendingBytes;
+	uint32_t maxSpanSize;
+	uint32_t pendingBytes;
+};
+
+template <typename slaveInfo, typename Profile>
+WriteBehindBuffer<slaveInfo, Profile>::WriteBehindBuffer(GenericMaster<slaveInfo, Profile> &master, const slaveInfo &slave):
+	master(master),
+	slave(slave),
+	runningCompletions(0),
+	statistics(),
+	maxDelay(0),
+	maxPendingBytes(256),
+	maxSpanSize(64),
+	pendingBytes(0)
+{}
+
+template <typename slaveInfo, typename Profile>
+void WriteBehindBuffer<slaveInfo, Profile>::setThresholds(uint32_t maxPendingBytes, std::chrono::microseconds maxDelay) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->maxPendingBytes = maxPendingBytes;
+	this->maxDelay = maxDelay;
+}
+
+template <typename slaveInfo, typename Profile>
+void WriteBehindBuffer<slaveInfo, Profile>::setMaxSpanSize(uint32_t size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	maxSpanSize = (size < Profile::DATA_LENGTH_MASK) ? size : Profile::DATA_LENGTH_MASK;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue WriteBehindBuffer<slaveInfo, Profile>::write(uint32_t memoryAddress, const uint8_t *data, uint32_t length, WriteCallback callback) {
+	if ( (length > Profile::DATA_LENGTH_MASK) || ((uint64_t)memoryAddress + length > (uint64_t)Profile::MAX_ADDRESS + 1) ) {
+		return ErrMemoryOutOfRange;
+	}
+
+	// Nothing to send.
+	if (length == 0) {
+		if (callback) {
+			callback(Ok);
+		}
+		return Ok;
+	}
+
+	Completions completions;
+	std::unique_lock<std::mutex> lock(mutex);
+	statistics.writes++;
+
+	const uint64_t end = (uint64_t)memoryAddress + length;
+
+	// Pending spans overlapping or adjacent to the write, [first, last).
+	uint32_t first = 0;
+	while ( (first < spans.size()) && (spans[first].memoryAddress + (uint64_t)spans[first].data.size() < memoryAddress) ) {
+		first++;
+	}
+	uint32_t last = first;
+	while ( (last < spans.size()) && (spans[last].memoryAddress <= end) ) {
+		last++;
+	}
+
+	uint64_t mergedStart = memoryAddress;
+	uint64_t mergedEnd = end;
+	if (first < last) {
+		mergedStart = (spans[first].memoryAddress < mergedStart) ? spans[first].memoryAddress : mergedStart;
+		mergedEnd = (spans[last - 1].memoryAddress + spans[last - 1].data.size() > mergedEnd) ? spans[last - 1].memoryAddress + spans[last - 1].data.size() : mergedEnd;
+	}
+
+	// Merged span would not fit into frame, pending part is sent first.
+	if ( (mergedEnd - mergedStart > maxSpanSize) && (first < last) ) {
+		flushSpans(first, last, completions);
+		last = first;
+		mergedStart = memoryAddress;
+		mergedEnd = end;
+	}
+
+	if (length > maxSpanSize) {
+		const StatusValue status = master.write(slave, memoryAddress, const_cast<uint8_t *>(data), length);
+		statistics.frames++;
+		statistics.bytes += length;
+
+		if (callback) {
+			completions.push_back({callback, status});
+		}
+	} else {
+		Span merged = {(uint32_t)mergedStart, std::vector<uint8_t>(mergedEnd - mergedStart), {}, Clock::now()};
+
+		for (uint32_t i = first; i < last; i++) {
+			memcpy(&merged.data[spans[i].memoryAddress - mergedStart], spans[i].data.data(), spans[i].data.size());
+			merged.callbacks.insert(merged.callbacks.end(), spans[i].callbacks.begin(), spans[i].callbacks.end());
+			merged.queuedAt = (spans[i].queuedAt < merged.queuedAt) ? spans[i].queuedAt : merged.queuedAt;
+			pendingBytes -= spans[i].data.size();
+		}
+
+		// The newest write is copied last, so its bytes win.
+		memcpy(&merged.data[memoryAddress - mergedStart], data, length);
+		if (callback) {
+			merged.callbacks.push_back(callback);
+		}
+		pendingBytes += merged.data.size();
+
+		spans.erase(spans.begin() + first, spans.begin() + last);
+		spans.insert(spans.begin() + first, std::move(merged));
+
+		checkThresholds(completions);
+	}
+
+	complete(lock, completions);
+
+	return Ok;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue WriteBehindBuffer<slaveInfo, Profile>::flush() {
+	Completions completions;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	const StatusValue status = flushSpans(0, spans.size(), completions);
+
+	complete(lock, completions);
+
+	// Writes sent by other threads may still wait for their callbacks.
+	if (callbackDepth == 0) {
+		lock.lock();
+		completionsFinished.wait(lock, [this] { return runningCompletions == 0; });
+	}
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue WriteBehindBuffer<slaveInfo, Profile>::read(uint32_t memoryAddress, uint8_t *buffer, uint32_t length) {
+	Completions completions;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	checkThresholds(completions);
+
+	const uint64_t end = (uint64_t)memoryAddress + length;
+
+	uint32_t first = 0;
+	while ( (first < spans.size()) && (spans[first].memoryAddress + (uint64_t)spans[first].data.size() <= memoryAddress) ) {
+		first++;
+	}
+	uint32_t last = first;
+	while ( (last < spans.size()) && (spans[last].memoryAddress < end) ) {
+		last++;
+	}
+
+	StatusValue status = flushSpans(first, last, completions);
+	if (status == Ok) {
+		status = master.read(slave, memoryAddress, buffer, length);
+	}
+
+	complete(lock, completions);
+
+	return status;
+}
+
+template <typename slaveInfo, typename Profile>
+void WriteBehindBuffer<slaveInfo, Profile>::process() {
+	Completions completions;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	checkThresholds(completions);
+
+	complete(lock, completions);
+}
+
+template <typename slaveInfo, typename Profile>
+uint32_t WriteBehindBuffer<slaveInfo, Profile>::getPendingBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pendingBytes;
+}
+
+template <typename slaveInfo, typename Profile>
+WriteBehindStatistics WriteBehindBuffer<slaveInfo, Profile>::getStatistics() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return statistics;
+}
+
+template <typename slaveInfo, typename Profile>
+StatusValue WriteBehindBuffer<slaveInfo, Profile>::flushSpans(uint32_t first, uint32_t last, Completions &completions) {
+	StatusValue result = Ok;
+
+	for (uint32_t i = first; i < last; i++) {
+		Span &span = spans[i];
+
+		const StatusValue status = master.write(slave, span.memoryAddress, span.data.data(), span.data.size());
+		statistics.frames++;
+		statistics.bytes += span.data.size();
+		pendingBytes -= span.data.size();
+
+		if ( (status != Ok) && (result == Ok) ) {
+			result = status;
+		}
+
+		for (WriteCallback &callback : span.callbacks) {
+			completions.push_back({std::move(callback), status});
+		}
+	}
+
+	spans.erase(spans.begin() + first, spans.begin() + last);
+	return result;
+}
+
+template <typename slaveInfo, typename Profile>
+void WriteBehindBuffer<slaveInfo, Profile>::checkThresholds(Completions &completions) {
+	if (spans.empty()) {
+		return;
+	}
+
+	bool expired = false;
+	if (maxDelay.count() > 0) {
+		const Clock::time_point now = Clock::now();
+		for (const Span &span : spans) {
+			expired = expired || (now - span.queuedAt >= maxDelay);
+		}
+	}
+
+	if ( (pendingBytes >= maxPendingBytes) || expired ) {
+		flushSpans(0, spans.size(), completions);
+	}
+}
+
+template <typename slaveInfo, typename Profile>
+void WriteBehindBuffer<slaveInfo, Profile>::complete(std::unique_lock<std::mutex> &lock, Completions &completions) {
+	if (completions.empty()) {
+		lock.unlock();
+		return;
+	}
+
+	runningCompletions++;
+	lock.unlock();
+
+	callbackDepth++;
+	for (auto &completion : completions) {
+		completion.first(completion.second);
+	}
+	callbackDepth--;
+
+	lock.lock();
+	if (--runningCompletions == 0) {
+		completionsFinished.notify_all();
+	}
+	lock.unlock();
+}
+
+template <typename slaveInfo, typename Profile>
+thread_local uint32_t WriteBehindBuffer<slaveInfo, Profile>::callbackDepth = 0;
@@ -19,7 +19,8 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 
 #include "picoMasterI2C.hpp"
 
-picoMasterI2C::picoMasterI2C(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKhz):
+template <typename Profile>
+BasicPicoMasterI2C<Profile>::BasicPicoMasterI2C(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKhz):
 	i2cInstance(i2c)
 {
 	// Setup SDA pin.
@@ -37,12 +38,28 @@ picoMasterI2C::picoMasterI2C(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t
 	i2c_init(i2c, i2cFreqKhz * 1000);
 }
 
-int picoMasterI2C::readBytes(uint8_t &slaveAddress, uint8_t *byteArray, uint32_t numberOfBytes) {
+template <typename Profile>
+int BasicPicoMasterI2C<Profile>::readBytes(uint8_t &slaveAddress, uint8_t *byteArray, uint32_t numberOfBytes) {
 	// One second timeout
 	return i2c_read_timeout_us(i2cInstance, slaveAddress, byteArray, numberOfBytes, false, 1000000);	
 }
 
-int picoMasterI2C::writeBytes(uint8_t &slaveAddress, uint8_t *byteArray, uint32_t numberOfBytes) {
+template <typename Profile>
+int BasicPicoMasterI2C<Profile>::writeBytes(uint8_t &slaveAddress, uint8_t *byteArray, uint32_t numberOfBytes) {
 	// One second timeout
 	return i2c_write_timeout_us(i2cInstance, slaveAddress, byteArray, numberOfBytes, false, 1000000);	
 }
+
+template <typename Profile>
+uint64_t BasicPicoMasterI2C<Profile>::getTimeUs() {
+	return time_us_64();
+}
+
+template <typename Profile>
+void BasicPicoMasterI2C<Profile>::sleepUs(uint32_t delayUs) {
+	sleep_us(delayUs);
+}
+
+template class BasicPicoMasterI2C<DefaultProfile>;
+template class BasicPicoMasterI2C<CompactProfile>;
+template class BasicPicoMasterI2C<TinyProfile>;
@@ -22,14 +22,17 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 
 #include <hardware/i2c.h>
 #include <hardware/gpio.h>
+#include <pico/time.h>
 
 #include "GenericMaster.hpp"
 
 // 7-bit I2C address is used to identify slave, so 8-bit int type is used
 // to pass slave's information (its address).
-class picoMasterI2C : public GenericMaster<uint8_t> {
+// Implementation is explicitly instantiated in picoMasterI2C.cpp for profiles defined in CommProfile.hpp.
+template <typename Profile>
+class BasicPicoMasterI2C : public GenericMaster<uint8_t, Profile> {
 public:
-	picoMasterI2C(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKHz);
+	BasicPicoMasterI2C(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKHz);
 
 protected:
 	// Hardware-specific function to read bytes from slave via I2C.
@@ -40,6 +43,17 @@ protected:
 	// Pass pico c sdk i2c_write() function result as return value.
 	int writeBytes(uint8_t &slaveAddress, uint8_t *byteArray, uint32_t numberOfBytes) override;
 
+	// Time source and delay of waitReady(), using pico c sdk timer.
+	uint64_t getTimeUs() override;
+	void sleepUs(uint32_t delayUs) override;
+
 private:
 	i2c_inst_t *i2cInstance; // i2c0 or i2c1
 };
+
+extern template class BasicPicoMasterI2C<DefaultProfile>;
+extern template class BasicPicoMasterI2C<CompactProfile>;
+extern template class BasicPicoMasterI2C<TinyProfile>;
+
+// I2C master using original frame layout.
+using picoMasterI2C = BasicPicoMasterI2C<DefaultProfile>;
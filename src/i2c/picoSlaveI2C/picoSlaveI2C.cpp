@@ -25,26 +25,35 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 // picoSlaveI2C object. Since the number of objects is limited by the number of I2C interfaces 
 // on the Pico, the handler can delegate the interrupt to the correct instance based on 
 // the originating I2C interface.
-picoSlaveI2C *ContextI2C0 = nullptr, *ContextI2C1 = nullptr;
+template <typename Profile>
+BasicPicoSlaveI2C<Profile> *BasicPicoSlaveI2C<Profile>::contextI2C0 = nullptr;
 
-static inline picoSlaveI2C* getContext(i2c_inst_t *i2c) {
-	return  (i2c == nullptr) ? (nullptr) : ( (i2c == i2c0) ? ContextI2C0 : ContextI2C1 );
-}
+template <typename Profile>
+BasicPicoSlaveI2C<Profile> *BasicPicoSlaveI2C<Profile>::contextI2C1 = nullptr;
 
 // I2C interface interrupt handler, that calls picoSlaveI2C object methods based on I2C events.
-void I2CInterruptHandler(i2c_inst_t *i2c, i2c_slave_event_t event) {
-	picoSlaveI2C *context = getContext(i2c);
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::interruptHandler(i2c_inst_t *i2c, i2c_slave_event_t event) {
+	BasicPicoSlaveI2C *context = (i2c == i2c0) ? contextI2C0 : contextI2C1;
 	
 	switch (event) {
 	
 	// Master has written some data
 	case I2C_SLAVE_RECEIVE:
-		context->writeHandler(i2c_read_byte_raw(i2c));
+		if (context->isDeferred()) {
+			context->deferredReceive(i2c_read_byte_raw(i2c));
+		} else {
+			context->writeHandler(i2c_read_byte_raw(i2c));
+		}
 		break;
 	
 	// Master is requesting data
 	case I2C_SLAVE_REQUEST:
-		i2c_write_byte_raw(i2c, context->readHandler());
+		if (context->isDeferred()) {
+			context->deferredRequest();
+		} else {
+			i2c_write_byte_raw(i2c, context->readHandler());
+		}
 		break;
 
 	default:
@@ -52,19 +61,27 @@ void I2CInterruptHandler(i2c_inst_t *i2c, i2c_slave_event_t event) {
 	}
 }
 
-picoSlaveI2C::picoSlaveI2C():
-	i2cInstance(nullptr)
+template <typename Profile>
+BasicPicoSlaveI2C<Profile>::BasicPicoSlaveI2C():
+	i2cInstance(nullptr),
+	responsePending(0),
+	deferred(false),
+	requestStalled(false)
 {}
 
-picoSlaveI2C::~picoSlaveI2C() {
-	picoSlaveI2C *toClear = getContext(this->i2cInstance);
+template <typename Profile>
+BasicPicoSlaveI2C<Profile>::~BasicPicoSlaveI2C() {
+	if (contextI2C0 == this) {
+		contextI2C0 = nullptr;
+	}
 
-	if (toClear != nullptr) {
-		toClear = nullptr;
+	if (contextI2C1 == this) {
+		contextI2C1 = nullptr;
 	}
 }
 
-void picoSlaveI2C::initialize(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKHz, uint8_t i2c_address, uint8_t *memory, uint32_t memorySize) {
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::initialize(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKHz, uint8_t i2c_address, uint8_t *memory, uint32_t memorySize) {
 	// Initialize SDA pin
 	gpio_init(sda);
 	gpio_set_function(sda, GPIO_FUNC_I2C);
@@ -77,14 +94,122 @@ void picoSlaveI2C::initialize(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_
 
 	// Initialize i2c
 	i2c_init(i2c, i2cFreqKHz * 1000);
-	i2c_slave_init(i2c, i2c_address, &I2CInterruptHandler);
+	i2c_slave_init(i2c, i2c_address, &interruptHandler);
+
+	i2cInstance = i2c;
 
 	// Set this object as context in I2C interface used by this object. 
 	if (i2c == i2c0) {
-		ContextI2C0 = this;
+		contextI2C0 = this;
 	} else {
-		ContextI2C1 = this;
+		contextI2C1 = this;
+	}
+
+	BasicGenericSlave<Profile>::initialize(memory, memorySize);
+}
+
+template <typename Profile>
+bool BasicPicoSlaveI2C<Profile>::enableDeferredMode(uint8_t *receiveBuffer, uint32_t receiveBufferSize, uint8_t *sendBuffer, uint32_t sendBufferSize) {
+	if ( (!receiveRing.initialize(receiveBuffer, receiveBufferSize)) || (!sendRing.initialize(sendBuffer, sendBufferSize)) ) {
+		deferred = false;
+		return false;
+	}
+
+	responsePending = 0;
+	requestStalled = false;
+	deferred = true;
+	return true;
+}
+
+template <typename Profile>
+bool BasicPicoSlaveI2C<Profile>::isDeferred() const {
+	return deferred;
+}
+
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::deferredReceive(uint8_t receivedByte) {
+	// Byte is dropped if ring is full, frame then fails checksum verification.
+	receiveRing.push(receivedByte);
+}
+
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::deferredRequest() {
+	uint8_t byte;
+
+	if (sendRing.pop(byte)) {
+		i2c_write_byte_raw(i2cInstance, byte);
+		return;
+	}
+
+	// Leave TX FIFO empty, controller holds SCL low until process() writes the byte.
+	// No further requests come until then, so process() is the only consumer of send ring meanwhile.
+	requestStalled = true;
+}
+
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::sendToMaster(uint32_t nBytes) {
+	// In deferred mode called from process(), response is generated right after request was parsed.
+	if (deferred) {
+		responsePending += nBytes;
+	}
+}
+
+#if EMBEDDEDCOMM_STATS_TIMING
+template <typename Profile>
+uint32_t BasicPicoSlaveI2C<Profile>::getTimeUs() {
+	return time_us_32();
+}
+#endif
+
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::process() {
+	if (deferred) {
+		uint8_t chunk[DEFERRED_CHUNK_SIZE];
+		uint32_t n;
+
+		// Master waits for response before sending next frame, so response is staged right after its request.
+		while ( (n = receiveRing.pop(chunk, sizeof(chunk))) > 0 ) {
+			this->writeHandler(chunk, n);
+			stageResponse();
+		}
+
+		stageResponse();
 	}
 
-	GenericSlave::initialize(memory, memorySize);
+	BasicGenericSlave<Profile>::process();
+
+	// Ready-wait status frame is answered once callbacks finished.
+	if (deferred) {
+		stageResponse();
+	}
 }
+
+template <typename Profile>
+void BasicPicoSlaveI2C<Profile>::stageResponse() {
+	uint8_t chunk[DEFERRED_CHUNK_SIZE];
+
+	while (responsePending > 0) {
+		uint32_t n = sendRing.space();
+		n = (n < responsePending) ? n : responsePending;
+		n = (n < sizeof(chunk)) ? n : sizeof(chunk);
+
+		if (n == 0) {
+			break;
+		}
+
+		this->readHandler(chunk, n);
+		sendRing.push(chunk, n);
+		responsePending -= n;
+	}
+
+	// Flag is cleared before the byte is written, next request cannot come earlier.
+	uint8_t byte;
+	if (requestStalled && sendRing.pop(byte)) {
+		requestStalled = false;
+		i2c_write_byte_raw(i2cInstance, byte);
+	}
+}
+
+template class BasicPicoSlaveI2C<DefaultProfile>;
+template class BasicPicoSlaveI2C<CompactProfile>;
+template class BasicPicoSlaveI2C<TinyProfile>;
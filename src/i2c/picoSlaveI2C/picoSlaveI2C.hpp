@@ -27,17 +27,65 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #include <hardware/i2c.h>
 
 #include "GenericSlave.hpp"
+#include "CommRing.hpp"
 
-class picoSlaveI2C : public GenericSlave {
+// Implementation is explicitly instantiated in picoSlaveI2C.cpp for profiles defined in CommProfile.hpp.
+template <typename Profile>
+class BasicPicoSlaveI2C : public BasicGenericSlave<Profile> {
 public:
-	picoSlaveI2C();
-	~picoSlaveI2C();
+	BasicPicoSlaveI2C();
+	~BasicPicoSlaveI2C();
 
 	// Initialize I2C interface and slave logic. Ensure that declared memory and receive buffer sizes match real ones.
 	void initialize(uint8_t scl, uint8_t sda, i2c_inst_t *i2c, uint32_t i2cFreqKHz, uint8_t i2c_address, uint8_t *memory, uint32_t memorySize);
 
+	// Enable deferred mode, call before initialize(). Interrupt handler only moves bytes between I2C FIFO and rings,
+	// frames are parsed and responses prepared in process(). Ring sizes must be powers of 2. Receive ring must hold
+	// all bytes master sends between process() calls. If response is not ready when master reads, clock is stretched
+	// until process() provides it. Returns false if ring sizes are invalid (slave stays in normal mode).
+	bool enableDeferredMode(uint8_t *receiveBuffer, uint32_t receiveBufferSize, uint8_t *sendBuffer, uint32_t sendBufferSize);
+
+	// Need to be called frequently, in deferred mode handles received frames.
+	void process();
+
+	bool isDeferred() const;
+
+	// Interrupt handler side of deferred mode.
+	void deferredReceive(uint8_t receivedByte);
+	void deferredRequest();
+
+protected:
+	void sendToMaster(uint32_t nBytes) override;
+
+#if EMBEDDEDCOMM_STATS_TIMING
+	// Statistics time source, hardware timer.
+	uint32_t getTimeUs() override;
+#endif
+
 private:
+	// I2C interrupt handler requires a plain function, so each object is mapped to interrupt source (i2c0 or i2c1).
+	static void interruptHandler(i2c_inst_t *i2c, i2c_slave_event_t event);
+	static BasicPicoSlaveI2C *contextI2C0;
+	static BasicPicoSlaveI2C *contextI2C1;
+
+	static constexpr uint32_t DEFERRED_CHUNK_SIZE = 32; // Bytes moved between rings and handlers at once (on stack).
+
+	// Move as much of pending response as fits into send ring, feed stretched request if needed.
+	void stageResponse();
+
 	i2c_inst_t *i2cInstance;
+	CommRing receiveRing; // Interrupt handler -> process().
+	CommRing sendRing; // process() -> interrupt handler.
+	uint32_t responsePending; // Response bytes announced by sendToMaster() and not yet staged.
+	volatile bool deferred;
+	std::atomic<bool> requestStalled; // Master waits for byte, send ring was empty in interrupt handler.
 };
 
+extern template class BasicPicoSlaveI2C<DefaultProfile>;
+extern template class BasicPicoSlaveI2C<CompactProfile>;
+extern template class BasicPicoSlaveI2C<TinyProfile>;
+
+// I2C slave using original frame layout.
+using picoSlaveI2C = BasicPicoSlaveI2C<DefaultProfile>;
+
 #endif
@@ -0,0 +1,209 @@
+/*
+LoopbackMaster.hpp
+
+Host-only implementation of GenericMaster class, which passes bytes directly to GenericSlave object
+living in the same process. Used to exercise and benchmark protocol without real hardware.
+
+Copyright (C) 2025 Mateusz Bogusławski, E: mateusz.boguslawski@ibnet.pl
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see https://www.gnu.org/licenses/.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "../GenericMaster.hpp"
+#include "../GenericSlave.hpp"
+
+// Parameters of simulated bus. Zero values disable simulation (bytes are passed instantly).
+struct LoopbackBus {
+	uint64_t bytesPerSecond = 0; // Bus bandwidth.
+	uint32_t transferLatencyUs = 0; // Fixed cost of every transfer (eg. USB frame scheduling).
+	uint32_t maxTransferSize = 0; // Longer writeBytes/readBytes calls are split into several transfers (eg. 64 for USB host
+	                              // transferring packet by packet), zero means no limit.
+};
+
+// Slave is identified by pointer to slave object using the same profile. Transactions to different slaves
+// can run concurrently from several threads.
+template <typename Profile>
+class BasicLoopbackMaster : public GenericMaster<BasicGenericSlave<Profile>*, Profile> {
+public:
+	using Slave = BasicGenericSlave<Profile>;
+
+	BasicLoopbackMaster(LoopbackBus bus = LoopbackBus());
+
+	// Set simulated bus parameters.
+	void setBus(LoopbackBus bus);
+
+	// If enabled (default), slave's process() is called before every frame sent by master,
+	// which simulates slave's main loop running between transactions.
+	void setAutoProcess(bool enabled);
+
+	// Number of bytes transferred in both directions since object creation.
+	uint64_t getBytesOnWire() const;
+
+	// Number of simulated transfers since object creation.
+	uint64_t getTransfers() const;
+
+#if EMBEDDEDCOMM_STATS
+	// Statistics are kept per slave, so transactions to different slaves may still run concurrently.
+	CommMasterStatistics &getStatistics(Slave* &slave) override;
+#endif
+
+protected:
+	int writeBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override;
+	int readBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) override;
+
+	// Segments are passed to slave one after another, without gathering.
+	int writeBytesV(Slave* &slave, const CommSegment *segments, uint32_t numberOfSegments) override;
+
+	// Wait for the time bus would need to transfer given number of bytes.
+	void simulateTransfer(uint32_t numberOfBytes);
+
+private:
+	static constexpr uint64_t SLEEP_THRESHOLD_NS = 100000;
+
+	LoopbackBus bus;
+	std::atomic<uint64_t> bytesOnWire;
+	std::atomic<uint64_t> transfers;
+	bool autoProcess;
+#if EMBEDDEDCOMM_STATS
+	std::map<Slave*, CommMasterStatistics> slaveStatistics; // Nodes are never removed, references stay valid.
+	std::mutex statisticsMutex;
+#endif
+};
+
+template <typename Profile>
+inline BasicLoopbackMaster<Profile>::BasicLoopbackMaster(LoopbackBus bus):
+	bus(bus),
+	bytesOnWire(0),
+	transfers(0),
+	autoProcess(true)
+{}
+
+template <typename Profile>
+inline void BasicLoopbackMaster<Profile>::setBus(LoopbackBus bus) {
+	this->bus = bus;
+}
+
+template <typename Profile>
+inline void BasicLoopbackMaster<Profile>::setAutoProcess(bool enabled) {
+	autoProcess = enabled;
+}
+
+template <typename Profile>
+inline uint64_t BasicLoopbackMaster<Profile>::getBytesOnWire() const {
+	return bytesOnWire;
+}
+
+template <typename Profile>
+inline uint64_t BasicLoopbackMaster<Profile>::getTransfers() const {
+	return transfers;
+}
+
+#if EMBEDDEDCOMM_STATS
+template <typename Profile>
+inline CommMasterStatistics &BasicLoopbackMaster<Profile>::getStatistics(Slave* &slave) {
+	std::lock_guard<std::mutex> lock(statisticsMutex);
+	return slaveStatistics[slave];
+}
+#endif
+
+template <typename Profile>
+inline int BasicLoopbackMaster<Profile>::writeBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) {
+	if (slave == nullptr) {
+		return -1;
+	}
+
+	if (autoProcess) {
+		slave->process();
+	}
+
+	simulateTransfer(numberOfBytes);
+
+	slave->writeHandler(byteArray, numberOfBytes);
+
+	return numberOfBytes;
+}
+
+template <typename Profile>
+inline int BasicLoopbackMaster<Profile>::writeBytesV(Slave* &slave, const CommSegment *segments, uint32_t numberOfSegments) {
+	if (slave == nullptr) {
+		return -1;
+	}
+
+	if (autoProcess) {
+		slave->process();
+	}
+
+	uint32_t totalSize = 0;
+	for (uint32_t i = 0; i < numberOfSegments; i++) {
+		totalSize += segments[i].size;
+	}
+
+	simulateTransfer(totalSize);
+
+	for (uint32_t i = 0; i < numberOfSegments; i++) {
+		slave->writeHandler(segments[i].data, segments[i].size);
+	}
+
+	return totalSize;
+}
+
+template <typename Profile>
+inline int BasicLoopbackMaster<Profile>::readBytes(Slave* &slave, uint8_t *byteArray, uint32_t numberOfBytes) {
+	if (slave == nullptr) {
+		return -1;
+	}
+
+	simulateTransfer(numberOfBytes);
+
+	slave->readHandler(byteArray, numberOfBytes);
+
+	return numberOfBytes;
+}
+
+template <typename Profile>
+inline void BasicLoopbackMaster<Profile>::simulateTransfer(uint32_t numberOfBytes) {
+	bytesOnWire += numberOfBytes;
+
+	uint32_t numberOfTransfers = 1;
+	if ( (bus.maxTransferSize > 0) && (numberOfBytes > bus.maxTransferSize) ) {
+		numberOfTransfers = (numberOfBytes + bus.maxTransferSize - 1) / bus.maxTransferSize;
+	}
+	transfers += numberOfTransfers;
+
+	uint64_t durationNs = (uint64_t)bus.transferLatencyUs * 1000 * numberOfTransfers;
+	if (bus.bytesPerSecond > 0) {
+		durationNs += (uint64_t)numberOfBytes * 1000000000ull / bus.bytesPerSecond;
+	}
+
+	if (durationNs == 0) {
+		return;
+	}
+
+	// Sleep functions are not accurate enough for microsecond delays, so only longer waits sleep and the rest
+	// is busy waited. Sleeping lets transfers to different slaves overlap like on independent buses.
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(durationNs);
+	if (durationNs > SLEEP_THRESHOLD_NS) {
+		std::this_thread::sleep_until(deadline - std::chrono::nanoseconds(SLEEP_THRESHOLD_NS));
+	}
+	while (std::chrono::steady_clock::now() < deadline) {}
+}
+
+// Loopback transport of original frame layout.
+using LoopbackMaster = BasicLoopbackMaster<DefaultProfile>;
@@ -1,28 +1,516 @@
 #include "linuxMasterUSB.hpp"
 
+// State of single asynchronous transaction.
+// Write: OUT [header + first data bytes] [full packets of data] [remaining data + checksum], IN [status].
+// Read: OUT [header], IN [full packets of data] [remaining data + checksum + status].
+// Full packets are transferred straight from/to caller's buffer, only partial packets are copied.
+struct linuxMasterUSB::AsyncTransaction {
+	linuxMasterUSB *master;
+	libusb_device_handle *dev;
+	bool read;
+	ChecksumMode mode;
+	uint32_t headerChecksum;
+	uint8_t *data;
+	uint32_t size;
+	uint32_t directSize; // Part of data transferred directly from/to caller's buffer.
+	uint8_t head[BULK_PACKET_SIZE];
+	uint32_t headSize;
+	uint32_t headerSize; // Frame header at the start of head, followed by data of writes.
+	uint8_t tail[BULK_PACKET_SIZE + MAX_CHECKSUM_SIZE + 1];
+	uint32_t tailSize;
+	uint32_t tailReceived; // Slave may split read tail into several packets.
+	uint8_t status;
+	libusb_transfer *transfers[MAX_ASYNC_TRANSFERS];
+	libusb_transfer *tailTransfer; // Read only, transfer receiving tail.
+	uint32_t submittedTransfers;
+	// Submitted transfers which did not complete yet, plus one reference held while transfers are being submitted.
+	// Whoever drops it to zero completes the transaction.
+	std::atomic<uint32_t> outstanding;
+	std::atomic<bool> failed;
+	AsyncCallback callback;
+#if EMBEDDEDCOMM_STATS
+	usbDevice *device;
+#endif
+#if EMBEDDEDCOMM_STATS_TIMING
+	uint64_t startUs; // Time transfers were submitted.
+#endif
+};
+
+// USB unit known to linuxMasterUSB.
+struct usbDevice {
+	linuxMasterUSB *owner;
+	uint16_t VID;
+	uint16_t PID;
+	std::string serialNumber;
+	std::string busPath;
+	libusb_device *dev; // Referenced while unit is connected, identifies it in hotplug events.
+	std::atomic<libusb_device_handle*> handle; // Claimed interface, nullptr while unit is disconnected.
+	linuxMasterUSB::ReceiveBuffer receiveBuffer;
+	std::atomic<bool> readyAnswerPending{false}; // Ready-wait status frame timed out, slave still sends its answer.
+	std::atomic<uint32_t> readyAnswerTimeoutMs{0}; // Timeout of that ready-wait, limits waiting for its answer.
+#if EMBEDDEDCOMM_STATS
+	CommMasterStatistics statistics;
+#endif
+};
+
 linuxMasterUSB::linuxMasterUSB():
-	ctx(nullptr)
+	ctx(nullptr),
+	hotplugHandle(0),
+	hotplugEnabled(false),
+	asyncPending(0),
+	eventThreadRunning(false)
 {
 	libusb_init(&ctx);
+
+	// Units (re)connected later are opened by event thread as soon as they appear.
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		int ret = libusb_hotplug_register_callback(ctx, (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+			LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			hotplugCallback, this, &hotplugHandle);
+
+		hotplugEnabled = (ret == LIBUSB_SUCCESS);
+	}
+
+	if (hotplugEnabled) {
+		eventThreadRunning = true;
+		eventThread = std::thread(&linuxMasterUSB::eventLoop, this);
+	}
 }
 
 linuxMasterUSB::~linuxMasterUSB() {
+	// Let asynchronous transactions finish, then stop event thread.
+	{
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		asyncIdle.wait(lock, [this] { return asyncPending == 0; });
+	}
+
+	if (hotplugEnabled) {
+		libusb_hotplug_deregister_callback(ctx, hotplugHandle);
+	}
+
+	if (eventThread.joinable()) {
+		eventThreadRunning = false;
+		eventThread.join();
+	}
+
+	for (const HotplugEvent &event : hotplugEvents) {
+		libusb_unref_device(event.device);
+	}
+
 	// Close and release all devices.
-	for (const auto &dev : openedDevices) {
-		libusb_release_interface(dev.second, 0);
-    	libusb_close(dev.second);
+	for (const auto &device : devices) {
+		libusb_device_handle *handle = device->handle;
+		if (handle != nullptr) {
+			libusb_release_interface(handle, 0);
+			libusb_close(handle);
+			libusb_unref_device(device->dev);
+		}
+	}
+
+	for (libusb_device_handle *handle : retiredHandles) {
+		libusb_close(handle);
+	}
+
+	libusb_exit(ctx);
+}
+
+std::future<StatusValue> linuxMasterUSB::readAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize) {
+	auto promise = std::make_shared<std::promise<StatusValue>>();
+	std::future<StatusValue> result = promise->get_future();
+
+	readAsync(slave, memoryAddress, buffer, readSize, [promise](StatusValue status) {
+		promise->set_value(status);
+	});
+
+	return result;
+}
+
+std::future<StatusValue> linuxMasterUSB::writeAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize) {
+	auto promise = std::make_shared<std::promise<StatusValue>>();
+	std::future<StatusValue> result = promise->get_future();
+
+	writeAsync(slave, memoryAddress, data, writeSize, [promise](StatusValue status) {
+		promise->set_value(status);
+	});
+
+	return result;
+}
+
+void linuxMasterUSB::readAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize, AsyncCallback callback) {
+	if (readSize > DATA_LENGTH_MASK) {
+		callback(ErrMemoryOutOfRange);
+		return;
+	}
+
+	libusb_device_handle* dev = openDevice(slave);
+	if ( (dev == nullptr) || (discardReadyAnswer(slave, dev) < 0) ) {
+		callback(0);
+		return;
+	}
+
+	auto t = std::make_shared<AsyncTransaction>();
+	t->master = this;
+	t->dev = dev;
+	t->read = true;
+	t->mode = getChecksumMode(slave);
+#if EMBEDDEDCOMM_STATS
+	t->device = slave.device;
+#endif
+	t->data = buffer;
+	t->size = readSize;
+	t->callback = std::move(callback);
+
+	t->headerChecksum = buildFrameHeader(slave, t->mode, t->head, t->headerSize, memoryAddress, t->size, true);
+	t->headSize = t->headerSize;
+
+	t->directSize = t->size - t->size % BULK_PACKET_SIZE;
+	t->tailSize = t->size % BULK_PACKET_SIZE + checksumSize(t->mode) + 1;
+
+	submitAsync(t);
+}
+
+void linuxMasterUSB::writeAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize, AsyncCallback callback) {
+	if (writeSize > DATA_LENGTH_MASK) {
+		callback(ErrMemoryOutOfRange);
+		return;
+	}
+
+	libusb_device_handle* dev = openDevice(slave);
+	if ( (dev == nullptr) || (discardReadyAnswer(slave, dev) < 0) ) {
+		callback(0);
+		return;
+	}
+
+	auto t = std::make_shared<AsyncTransaction>();
+	t->master = this;
+	t->dev = dev;
+	t->read = false;
+	t->mode = getChecksumMode(slave);
+#if EMBEDDEDCOMM_STATS
+	t->device = slave.device;
+#endif
+	t->data = data;
+	t->size = (data == nullptr) ? 0 : writeSize;
+	t->callback = std::move(callback);
+
+	t->headerChecksum = buildFrameHeader(slave, t->mode, t->head, t->headerSize, memoryAddress, t->size, false);
+
+	// First packet carries header and as much data as fits.
+	uint32_t headData = std::min(BULK_PACKET_SIZE - t->headerSize, t->size);
+	if (headData > 0) {
+		memcpy(&t->head[t->headerSize], data, headData);
+	}
+	t->headSize = t->headerSize + headData;
+
+	// Then full packets straight from caller's buffer, the rest is sent together with checksum.
+	uint32_t remaining = t->size - headData;
+	t->directSize = remaining - remaining % BULK_PACKET_SIZE;
+
+	uint32_t tailData = remaining - t->directSize;
+	if (tailData > 0) {
+		memcpy(t->tail, data + headData + t->directSize, tailData);
+	}
+	buildWriteChecksum(t->mode, t->headerChecksum, data, t->size, &t->tail[tailData]);
+	t->tailSize = tailData + checksumSize(t->mode);
+
+	submitAsync(t);
+}
+
+void linuxMasterUSB::submitAsync(std::shared_ptr<AsyncTransaction> transaction) {
+	bool startNow;
+	{
+		std::lock_guard<std::mutex> lock(asyncMutex);
+
+		if (!eventThreadRunning) {
+			if (eventThread.joinable()) {
+				eventThread.join();
+			}
+			eventThreadRunning = true;
+			eventThread = std::thread(&linuxMasterUSB::eventLoop, this);
+		}
+
+		auto &queue = asyncQueues[transaction->dev];
+		queue.push_back(transaction);
+		startNow = (queue.size() == 1);
+		asyncPending++;
+	}
+
+	if (startNow && !startTransaction(transaction.get())) {
+		finishTransaction(transaction.get(), 0);
 	}
 }
 
+bool linuxMasterUSB::startTransaction(AsyncTransaction *t) {
+	t->submittedTransfers = 0;
+	t->tailTransfer = nullptr;
+	t->tailReceived = 0;
+	t->outstanding = 1;
+	t->failed = false;
+#if EMBEDDEDCOMM_STATS_TIMING
+	t->startUs = t->master->getTimeUs();
+#endif
+
+	// All transfers of transaction are queued at once, libusb keeps their order within endpoint.
+	bool ok = submitTransfer(t, BULK_OUT_ENDPOINT, t->head, t->headSize);
+
+	if (t->read) {
+		if (ok && (t->directSize > 0)) {
+			ok = submitTransfer(t, BULK_IN_ENDPOINT, t->data, t->directSize);
+		}
+		ok = ok && submitTransfer(t, BULK_IN_ENDPOINT, t->tail, t->tailSize, true);
+	} else {
+		if (ok && (t->directSize > 0)) {
+			ok = submitTransfer(t, BULK_OUT_ENDPOINT, t->data + t->headSize - t->headerSize, t->directSize);
+		}
+		if (ok && (t->tailSize > 0)) {
+			ok = submitTransfer(t, BULK_OUT_ENDPOINT, t->tail, t->tailSize);
+		}
+		ok = ok && submitTransfer(t, BULK_IN_ENDPOINT, &t->status, 1);
+	}
+
+	if (!ok) {
+		if (t->submittedTransfers == 0) {
+			return false;
+		}
+
+		// Cancel what was already submitted, transaction finishes once all of them complete.
+		t->failed = true;
+		for (uint32_t i = 0; i < t->submittedTransfers; i++) {
+			libusb_cancel_transfer(t->transfers[i]);
+		}
+	}
+
+	// Drop reference held while submitting.
+	if (--t->outstanding == 0) {
+		completeTransaction(t);
+	}
+
+	return true;
+}
+
+bool linuxMasterUSB::submitTransfer(AsyncTransaction *t, uint8_t endpoint, uint8_t *buffer, uint32_t length, bool tail) {
+	libusb_transfer *transfer = libusb_alloc_transfer(0);
+	if (transfer == nullptr) {
+		return false;
+	}
+
+	libusb_fill_bulk_transfer(transfer, t->dev, endpoint, buffer, length, &linuxMasterUSB::transferCallback, t, TRANSFER_TIMEOUT_MS);
+
+	t->transfers[t->submittedTransfers] = transfer;
+	t->outstanding++;
+	if (tail) {
+		t->tailTransfer = transfer;
+	}
+
+	if (libusb_submit_transfer(transfer) < 0) {
+		t->outstanding--;
+		libusb_free_transfer(transfer);
+		return false;
+	}
+
+	t->submittedTransfers++;
+	return true;
+}
+
+void LIBUSB_CALL linuxMasterUSB::transferCallback(libusb_transfer *transfer) {
+	AsyncTransaction *t = (AsyncTransaction*)transfer->user_data;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		t->failed = true;
+	} else if (transfer == t->tailTransfer) {
+		// Slave may send last data bytes and checksum with status in separate packets, wait for the rest.
+		t->tailReceived += transfer->actual_length;
+		if ( (t->tailReceived < t->tailSize) && !t->failed ) {
+			libusb_fill_bulk_transfer(transfer, t->dev, BULK_IN_ENDPOINT, &t->tail[t->tailReceived], t->tailSize - t->tailReceived,
+				&linuxMasterUSB::transferCallback, t, TRANSFER_TIMEOUT_MS);
+			if (libusb_submit_transfer(transfer) == 0) {
+				return;
+			}
+			t->failed = true;
+		}
+	} else if (transfer->actual_length != transfer->length) {
+		t->failed = true;
+	}
+
+	if (--t->outstanding == 0) {
+		completeTransaction(t);
+	}
+}
+
+void linuxMasterUSB::completeTransaction(AsyncTransaction *t) {
+	for (uint32_t i = 0; i < t->submittedTransfers; i++) {
+		libusb_free_transfer(t->transfers[i]);
+	}
+
+	StatusValue status = 0;
+	if (!t->failed) {
+		if (t->read) {
+			// Move remaining data bytes from tail to caller's buffer.
+			const uint32_t tailData = t->size - t->directSize;
+			memcpy(t->data + t->directSize, t->tail, tailData);
+			status = checkReadResponse(t->mode, t->headerChecksum, t->data, t->size, &t->tail[tailData]);
+		} else {
+			status = t->status;
+		}
+	}
+
+	t->master->finishTransaction(t, status);
+}
+
+void linuxMasterUSB::finishTransaction(AsyncTransaction *t, StatusValue status) {
+	std::shared_ptr<AsyncTransaction> finished;
+	std::shared_ptr<AsyncTransaction> next;
+
+	{
+		std::lock_guard<std::mutex> lock(asyncMutex);
+		auto &queue = asyncQueues[t->dev];
+		finished = queue.front();
+		queue.pop_front();
+
+		if (!queue.empty()) {
+			next = queue.front();
+		}
+	}
+
+#if EMBEDDEDCOMM_STATS
+	// Transactions of one device complete one at a time.
+	const uint32_t bytesOut = t->headSize + (t->read ? 0 : (t->directSize + t->tailSize));
+	const uint32_t bytesIn = t->read ? (t->size + checksumSize(t->mode) + 1) : 1;
+	t->device->statistics.recordFrame(bytesOut, bytesIn, status);
+#if EMBEDDEDCOMM_STATS_TIMING
+	t->device->statistics.latency.record((uint32_t)(getTimeUs() - t->startUs));
+#endif
+#endif
+
+	finished->callback(status);
+
+	// Start next transaction for this device, skip those which cannot be submitted.
+	while ( (next != nullptr) && !startTransaction(next.get()) ) {
+		std::shared_ptr<AsyncTransaction> failed;
+		{
+			std::lock_guard<std::mutex> lock(asyncMutex);
+			auto &queue = asyncQueues[t->dev];
+			failed = queue.front();
+			queue.pop_front();
+			next = queue.empty() ? nullptr : queue.front();
+			asyncPending--;
+		}
+
+		// Callback may submit further transactions, so it runs without the lock.
+		failed->callback(0);
+	}
+
+	std::lock_guard<std::mutex> lock(asyncMutex);
+	asyncPending--;
+	if (asyncPending == 0) {
+		asyncIdle.notify_all();
+	}
+}
+
+void linuxMasterUSB::eventLoop() {
+	while (eventThreadRunning) {
+		struct timeval timeout = {0, EVENT_LOOP_TIMEOUT_US};
+		libusb_handle_events_timeout_completed(ctx, &timeout, nullptr);
+
+		if (hotplugEnabled) {
+			handleHotplugEvents();
+		}
+	}
+}
+
+ChecksumMode linuxMasterUSB::getChecksumMode(slaveInfo &slave) {
+	return slave.checksumMode;
+}
+
 int linuxMasterUSB::writeBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t numberOfBytes) {
 	libusb_device_handle* dev = openDevice(slave);
 	if (dev == nullptr) {
-		return 0;
+		return LIBUSB_ERROR_NO_DEVICE;
+	}
+
+	// New frame, drop leftovers of previous response.
+	slave.device->receiveBuffer = ReceiveBuffer();
+
+	int ret = discardReadyAnswer(slave, dev);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = bulkOut(dev, byteArray, numberOfBytes);
+	if (ret < 0) {
+		transferFailed(slave, dev, ret);
+	}
+
+	return ret;
+}
+
+int linuxMasterUSB::writeBytesV(slaveInfo &slave, const CommSegment *segments, uint32_t numberOfSegments) {
+	libusb_device_handle* dev = openDevice(slave);
+	if (dev == nullptr) {
+		return LIBUSB_ERROR_NO_DEVICE;
+	}
+
+	slave.device->receiveBuffer = ReceiveBuffer();
+
+	int ret = discardReadyAnswer(slave, dev);
+	if (ret < 0) {
+		return ret;
+	}
+
+	uint8_t packet[BULK_PACKET_SIZE];
+	uint32_t packetFill = 0;
+	int written = 0;
+
+	for (uint32_t i = 0; i < numberOfSegments; i++) {
+		uint8_t *data = segments[i].data;
+		uint32_t size = segments[i].size;
+
+		while (size > 0) {
+			uint32_t n;
+			int ret;
+
+			if ( (packetFill == 0) && (size >= BULK_PACKET_SIZE) ) {
+				// Send all full packets straight from caller's buffer.
+				n = size - size % BULK_PACKET_SIZE;
+				ret = bulkOut(dev, data, n);
+			} else {
+				// Pack small segments (and remainders) together.
+				n = std::min(BULK_PACKET_SIZE - packetFill, size);
+				memcpy(&packet[packetFill], data, n);
+				packetFill += n;
+				ret = 0;
+
+				if (packetFill == BULK_PACKET_SIZE) {
+					ret = bulkOut(dev, packet, packetFill);
+					packetFill = 0;
+				}
+			}
+
+			if (ret < 0) {
+				transferFailed(slave, dev, ret);
+				return ret;
+			}
+
+			written += n;
+			data += n;
+			size -= n;
+		}
+	}
+
+	if (packetFill > 0) {
+		int ret = bulkOut(dev, packet, packetFill);
+		if (ret < 0) {
+			transferFailed(slave, dev, ret);
+			return ret;
+		}
 	}
 
+	return written;
+}
+
+int linuxMasterUSB::bulkOut(libusb_device_handle *dev, uint8_t *byteArray, uint32_t numberOfBytes) {
 	int written = 0;
-	int ret = 0;
-	ret = libusb_bulk_transfer(dev, 0x01, byteArray, numberOfBytes, &written, 1000000);
+	int ret = libusb_bulk_transfer(dev, BULK_OUT_ENDPOINT, byteArray, numberOfBytes, &written, TRANSFER_TIMEOUT_MS);
 
 	if (ret < 0) {
 		return ret;
@@ -31,57 +519,336 @@ int linuxMasterUSB::writeBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t nu
 	return written;
 }
 
+StatusValue linuxMasterUSB::waitReady(slaveInfo &slave, uint32_t timeoutUs) {
+	// libusb treats zero timeout as infinite.
+	if (timeoutUs < 1000) {
+		return GenericMaster::waitReady(slave, timeoutUs);
+	}
+
+	uint8_t frame[MAX_VARINT_SIZE];
+	uint32_t frameSize = buildStatusFrame(slave, frame, READY_FRAME_LENGTH);
+	if (writeBytes(slave, frame, frameSize) < 0) {
+		return 0;
+	}
 
-int linuxMasterUSB::readBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t numberOfBytes) {
 	libusb_device_handle* dev = openDevice(slave);
 	if (dev == nullptr) {
 		return 0;
 	}
 
-	// One transfer can have up to 64 bytes. Sometimes single read will be not enough.
-	uint32_t toRead = numberOfBytes;
-	while (toRead > 0) {
+	StatusValue status = 0;
+	int ret = receiveReadyAnswer(slave, dev, status, timeoutUs / 1000);
+	if (ret == LIBUSB_ERROR_TIMEOUT) {
+		slave.device->readyAnswerTimeoutMs = timeoutUs / 1000;
+		slave.device->readyAnswerPending = true;
+		return Busy;
+	}
+
+	return (ret < 0) ? 0 : status;
+}
+
+#if EMBEDDEDCOMM_STATS
+CommMasterStatistics &linuxMasterUSB::getStatistics(slaveInfo &slave) {
+	if (slave.device == nullptr) {
+		return GenericMaster::getStatistics(slave);
+	}
+
+	return slave.device->statistics;
+}
+#endif
+
+int linuxMasterUSB::receiveReadyAnswer(slaveInfo &slave, libusb_device_handle *dev, StatusValue &status, uint32_t timeoutMs) {
+	// Answer is a single byte, sent as short packet.
+	uint8_t packet[BULK_PACKET_SIZE];
+	int bytesRead = 0;
+	int ret = libusb_bulk_transfer(dev, BULK_IN_ENDPOINT, packet, BULK_PACKET_SIZE, &bytesRead, timeoutMs);
+
+	if (bytesRead > 0) {
+		status = packet[0];
+		return bytesRead;
+	}
+
+	if (ret == 0) {
+		ret = LIBUSB_ERROR_IO;
+	}
+	if (ret != LIBUSB_ERROR_TIMEOUT) {
+		transferFailed(slave, dev, ret);
+	}
+
+	return ret;
+}
+
+int linuxMasterUSB::discardReadyAnswer(slaveInfo &slave, libusb_device_handle *dev) {
+	if (!slave.device->readyAnswerPending) {
+		return 0;
+	}
+
+	StatusValue status;
+	int ret = receiveReadyAnswer(slave, dev, status, slave.device->readyAnswerTimeoutMs);
+	slave.device->readyAnswerPending = false;
+
+	// Slave hanging in its callback fails the frame instead of blocking every caller, answer is not waited for again.
+	if (ret == LIBUSB_ERROR_TIMEOUT) {
+		libusb_clear_halt(dev, BULK_IN_ENDPOINT);
+	}
+
+	return ret;
+}
+
+int linuxMasterUSB::readBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t numberOfBytes) {
+	libusb_device_handle* dev = openDevice(slave);
+	if (dev == nullptr) {
+		return LIBUSB_ERROR_NO_DEVICE;
+	}
+
+	ReceiveBuffer *pending = &slave.device->receiveBuffer;
+	uint32_t received = 0;
+
+	while (received < numberOfBytes) {
 		int bytesRead = 0;
-		int ret = libusb_bulk_transfer(dev, 0x81, &byteArray[numberOfBytes-toRead], std::min((uint32_t)64, toRead), &bytesRead, 1000000);
-		
+		int ret = 0;
+
+		if (pending->offset < pending->size) {
+			// Rest of previously received packet.
+			uint32_t n = std::min(pending->size - pending->offset, numberOfBytes - received);
+			memcpy(&byteArray[received], &pending->data[pending->offset], n);
+			pending->offset += n;
+			received += n;
+
+		} else if (numberOfBytes - received >= BULK_PACKET_SIZE) {
+			// All full packets in one transfer. Transfer must be multiple of packet size,
+			// otherwise packet longer than remaining space would overflow it.
+			uint32_t n = numberOfBytes - received;
+			n -= n % BULK_PACKET_SIZE;
+			ret = libusb_bulk_transfer(dev, BULK_IN_ENDPOINT, &byteArray[received], n, &bytesRead, TRANSFER_TIMEOUT_MS);
+			received += bytesRead;
+
+		} else {
+			// Last packet may carry more bytes than requested (eg. checksum and status after data).
+			ret = libusb_bulk_transfer(dev, BULK_IN_ENDPOINT, pending->data, BULK_PACKET_SIZE, &bytesRead, TRANSFER_TIMEOUT_MS);
+			pending->size = bytesRead;
+			pending->offset = 0;
+		}
+
 		if (ret < 0) {
+			*pending = ReceiveBuffer();
+			transferFailed(slave, dev, ret);
 			return ret;
 		}
-
-		toRead -= std::min((uint32_t)64, toRead);
 	}
 
-
 	return numberOfBytes;
 }
 
 libusb_device_handle* linuxMasterUSB::openDevice(slaveInfo &slave) {
-	if (openedDevices.find(slave) != openedDevices.end()) {
-		// Device already opened, ready to use.
-		return openedDevices[slave];
+	// Unit already found for this slave.
+	usbDevice *device = slave.device;
+	if ( (device != nullptr) && (device->owner == this) ) {
+		libusb_device_handle *handle = device->handle;
+		if (handle != nullptr) {
+			return handle;
+		}
 	}
 
-	libusb_device_handle *devHandle = libusb_open_device_with_vid_pid(ctx, slave.VID, slave.PID);
+	std::lock_guard<std::mutex> lock(devicesMutex);
+
+	device = findDevice(slave);
 
-	if (devHandle == nullptr) {
+	// With hotplug, bus is scanned only when slave is requested for the first time, units connected later
+	// are opened by event thread. Without it, bus is scanned whenever slave is missing.
+	if (device == nullptr) {
+		bool firstRequest = watchedIds.insert(std::make_pair(slave.VID, slave.PID)).second;
+
+		if (firstRequest || !hotplugEnabled) {
+			scanDevices(slave.VID, slave.PID);
+			device = findDevice(slave);
+		}
+	}
+
+	if (device == nullptr) {
 		return nullptr;
 	}
 
+	slave.device = device;
+	return device->handle;
+}
+
+usbDevice* linuxMasterUSB::findDevice(const slaveInfo &slave) {
+	for (const auto &device : devices) {
+		if ( (device->handle == nullptr) || (device->VID != slave.VID) || (device->PID != slave.PID) ) {
+			continue;
+		}
+
+		if ( (!slave.serialNumber.empty()) && (slave.serialNumber != device->serialNumber) ) {
+			continue;
+		}
+
+		if ( (!slave.busPath.empty()) && (slave.busPath != device->busPath) ) {
+			continue;
+		}
+
+		return device.get();
+	}
+
+	return nullptr;
+}
+
+void linuxMasterUSB::scanDevices(uint16_t VID, uint16_t PID) {
+	libusb_device **list;
+	ssize_t count = libusb_get_device_list(ctx, &list);
+	if (count < 0) {
+		return;
+	}
+
+	for (ssize_t i = 0; i < count; i++) {
+		libusb_device_descriptor descriptor;
+		if (libusb_get_device_descriptor(list[i], &descriptor) < 0) {
+			continue;
+		}
+
+		if ( (descriptor.idVendor == VID) && (descriptor.idProduct == PID) ) {
+			registerDevice(list[i]);
+		}
+	}
+
+	libusb_free_device_list(list, 1);
+}
+
+void linuxMasterUSB::registerDevice(libusb_device *dev) {
+	for (const auto &device : devices) {
+		if ( (device->handle != nullptr) && (device->dev == dev) ) {
+			return;
+		}
+	}
+
+	libusb_device_descriptor descriptor;
+	if (libusb_get_device_descriptor(dev, &descriptor) < 0) {
+		return;
+	}
+
+	libusb_device_handle *handle;
+	if (libusb_open(dev, &handle) < 0) {
+		return;
+	}
+
 	// Detach kernel driver if active.
-	if (libusb_kernel_driver_active(devHandle, 0)) {
-		libusb_detach_kernel_driver(devHandle, 0);
+	if (libusb_kernel_driver_active(handle, 0)) {
+		libusb_detach_kernel_driver(handle, 0);
 	}
 
-	if (libusb_claim_interface(devHandle, 0) < 0) {
-		libusb_close(devHandle);
-		return nullptr;
+	if (libusb_claim_interface(handle, 0) < 0) {
+		libusb_close(handle);
+		return;
 	}
 
-	std::pair<slaveInfo, libusb_device_handle*> toInsert;
-	toInsert.first = slave;
-	toInsert.second = devHandle;
+	std::string serialNumber;
+	if (descriptor.iSerialNumber != 0) {
+		unsigned char buffer[128];
+		int length = libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber, buffer, sizeof(buffer));
+		if (length > 0) {
+			serialNumber.assign((const char*)buffer, length);
+		}
+	}
 
-	openedDevices.insert(toInsert);
-	
-	return devHandle;
+	uint8_t ports[7];
+	int depth = libusb_get_port_numbers(dev, ports, sizeof(ports));
+	std::string busPath = std::to_string(libusb_get_bus_number(dev));
+	for (int i = 0; i < depth; i++) {
+		busPath += ((i == 0) ? "-" : ".") + std::to_string(ports[i]);
+	}
+
+	// Reconnected unit is recognized by serial number, or by port if it has none.
+	usbDevice *entry = nullptr;
+	for (const auto &device : devices) {
+		if ( (device->handle != nullptr) || (device->VID != descriptor.idVendor) || (device->PID != descriptor.idProduct) ) {
+			continue;
+		}
+
+		if (serialNumber.empty() ? (device->busPath == busPath) : (device->serialNumber == serialNumber)) {
+			entry = device.get();
+			break;
+		}
+	}
+
+	if (entry == nullptr) {
+		devices.emplace_back(new usbDevice());
+		entry = devices.back().get();
+		entry->owner = this;
+		entry->VID = descriptor.idVendor;
+		entry->PID = descriptor.idProduct;
+	}
+
+	entry->serialNumber = serialNumber;
+	entry->busPath = busPath;
+	entry->dev = libusb_ref_device(dev);
+	entry->receiveBuffer = ReceiveBuffer();
+	entry->handle = handle;
+}
+
+void linuxMasterUSB::unregisterDevice(usbDevice *device, libusb_device_handle *handle) {
+	if ( (handle == nullptr) || (device->handle != handle) ) {
+		return;
+	}
+
+	// Other threads may still use the handle, it is closed together with master.
+	device->handle = nullptr;
+	retiredHandles.push_back(handle);
+
+	libusb_unref_device(device->dev);
+	device->dev = nullptr;
+
+	// Reconnected unit owes no answer.
+	device->readyAnswerPending = false;
+}
+
+void linuxMasterUSB::transferFailed(slaveInfo &slave, libusb_device_handle *handle, int error) {
+	if (error != LIBUSB_ERROR_NO_DEVICE) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(devicesMutex);
+	unregisterDevice(slave.device, handle);
+}
+
+int LIBUSB_CALL linuxMasterUSB::hotplugCallback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *userData) {
+	linuxMasterUSB *master = (linuxMasterUSB*)userData;
+
+	std::lock_guard<std::mutex> lock(master->hotplugMutex);
+	master->hotplugEvents.push_back({libusb_ref_device(dev), event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED});
+
+	return 0;
+}
+
+void linuxMasterUSB::handleHotplugEvents() {
+	std::vector<HotplugEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(hotplugMutex);
+		events.swap(hotplugEvents);
+	}
+
+	if (events.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(devicesMutex);
+
+	for (const HotplugEvent &event : events) {
+		if (event.arrived) {
+			libusb_device_descriptor descriptor;
+			bool watched = (libusb_get_device_descriptor(event.device, &descriptor) == 0) &&
+				(watchedIds.count(std::make_pair(descriptor.idVendor, descriptor.idProduct)) > 0);
+
+			if (watched) {
+				registerDevice(event.device);
+			}
+		} else {
+			for (const auto &device : devices) {
+				if ( (device->dev == event.device) && (device->handle != nullptr) ) {
+					unregisterDevice(device.get(), device->handle);
+				}
+			}
+		}
+
+		libusb_unref_device(event.device);
+	}
 }
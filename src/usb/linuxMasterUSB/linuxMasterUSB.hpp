@@ -20,37 +20,191 @@ along with this program.  If not, see https://www.gnu.org/licenses/.
 #include "../../GenericMaster.hpp"
 
 #include <libusb-1.0/libusb.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
-// Product ID and vendor ID pair can identify usb slave device.
+// USB unit opened by linuxMasterUSB.
+struct usbDevice;
+
+// Product ID and vendor ID pair can identify usb slave device. Units sharing VID/PID
+// are told apart by serial number or by bus/port path.
 struct slaveInfo {
 	uint16_t PID; // Product ID
 	uint16_t VID; // Vendor ID
+	ChecksumMode checksumMode = ChecksumCRC8; // Checksum used in frames exchanged with this slave.
+	std::string serialNumber; // Serial number string descriptor, empty matches any unit.
+	std::string busPath; // Bus and port numbers, eg. "1-4.2", empty matches any unit.
+
+	// Unit found for this slave, cached by linuxMasterUSB so following transfers do not search for it.
+	// Reset to nullptr after changing fields above.
+	usbDevice *device = nullptr;
 
 	bool operator==(const slaveInfo& other) const {
-        return VID == other.VID && PID == other.PID;
-    }
+		return std::tie(VID, PID, serialNumber, busPath) == std::tie(other.VID, other.PID, other.serialNumber, other.busPath);
+	}
 
 	bool operator<(const slaveInfo& other) const {
-        return VID < other.VID && PID < other.PID;
-    }
+		return std::tie(VID, PID, serialNumber, busPath) < std::tie(other.VID, other.PID, other.serialNumber, other.busPath);
+	}
 };
 
+// Invoked from USB event thread when asynchronous transaction finishes.
+// Status has the same meaning as value returned by read()/write().
+using AsyncCallback = std::function<void(StatusValue status)>;
+
 class linuxMasterUSB : public GenericMaster<slaveInfo> {
 public:
 	linuxMasterUSB();
 	~linuxMasterUSB();
 
+	// Asynchronous read/write. Frames are the same as in read()/write(), but transfers are submitted with
+	// libusb_submit_transfer() and completed by internal event thread, so calling thread does not wait
+	// and many slaves can be served at once. Transactions for the same slave are executed one at a time,
+	// in order of submission (protocol is half-duplex), with all OUT and IN transfers of a transaction
+	// queued together. Buffers must stay valid until transaction completes. Sizes above DATA_LENGTH_MASK
+	// complete at once with ErrMemoryOutOfRange.
+	std::future<StatusValue> readAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize);
+	std::future<StatusValue> writeAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize);
+
+	// Callback based variants of the above.
+	void readAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *buffer, uint32_t readSize, AsyncCallback callback);
+	void writeAsync(slaveInfo &slave, uint32_t memoryAddress, uint8_t *data, uint32_t writeSize, AsyncCallback callback);
+
+	// Send ready-wait status frame and block in bulk IN transfer until slave answers it (once its process()
+	// cleared Busy), instead of polling. Timeouts shorter than 1 ms poll as GenericMaster::waitReady().
+	// If slave does not answer in time, its answer is received before the next frame is sent, waiting at most
+	// timeoutUs again. If it still does not come, that frame fails with transport error.
+	StatusValue waitReady(slaveInfo &slave, uint32_t timeoutUs) override;
+
+#if EMBEDDEDCOMM_STATS
+	// Statistics are kept per unit and include asynchronous frames. Slave which was never found
+	// uses statistics shared by such slaves.
+	CommMasterStatistics &getStatistics(slaveInfo &slave) override;
+#endif
+
 protected:
+	// Each slave may use different checksum mode.
+	ChecksumMode getChecksumMode(slaveInfo &slave) override;
+
+	// Slave sends whole response as one stream of packets. Full packets are received straight into
+	// caller's buffer in one transfer, remaining bytes of the last packet are kept for next call.
 	int readBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t numberOfBytes) override;
 	int writeBytes(slaveInfo &slave, uint8_t *byteArray, uint32_t numberOfBytes) override;
 
+	// Send segments without gathering whole frame. Small segments are packed together into
+	// full packets, large ones are passed to libusb directly from caller's buffer.
+	int writeBytesV(slaveInfo &slave, const CommSegment *segments, uint32_t numberOfSegments) override;
+
 private:
+	static constexpr uint8_t BULK_OUT_ENDPOINT = 0x01;
+	static constexpr uint8_t BULK_IN_ENDPOINT = 0x81;
+	static constexpr uint32_t BULK_PACKET_SIZE = 64; // Full-speed device.
+	static constexpr uint32_t TRANSFER_TIMEOUT_MS = 1000000;
+
+	static constexpr uint32_t MAX_ASYNC_TRANSFERS = 4; // Per transaction.
+	static constexpr uint32_t EVENT_LOOP_TIMEOUT_US = 100000;
+
+	struct AsyncTransaction;
+	friend struct usbDevice;
+
+	// Bytes of last received packet not consumed by readBytes() yet.
+	struct ReceiveBuffer {
+		uint8_t data[BULK_PACKET_SIZE];
+		uint32_t size = 0;
+		uint32_t offset = 0;
+	};
 
+	// Hotplug event waiting to be handled by event thread.
+	struct HotplugEvent {
+		libusb_device *device; // Referenced until event is handled.
+		bool arrived;
+	};
+
+	// Returns handle of unit matching slave, or nullptr if it is not connected. Once found, unit is cached
+	// in slave.device and looked up without searching.
 	libusb_device_handle* openDevice(slaveInfo &slave);
 
-	std::map<slaveInfo, libusb_device_handle*> openedDevices;
+	// Connected unit matching slave. Requires devicesMutex.
+	usbDevice* findDevice(const slaveInfo &slave);
+
+	// Open all connected units with given VID/PID which are not opened yet. Requires devicesMutex.
+	void scanDevices(uint16_t VID, uint16_t PID);
+
+	// Open and claim unit. Unit which was connected before gets its previous entry back. Requires devicesMutex.
+	void registerDevice(libusb_device *dev);
+
+	// Forget handle of disconnected unit. Requires devicesMutex.
+	void unregisterDevice(usbDevice *device, libusb_device_handle *handle);
+
+	// Transfer failed, if unit is gone mark it disconnected so it is searched for again.
+	void transferFailed(slaveInfo &slave, libusb_device_handle *handle, int error);
+
+	// Invoked by libusb while handling events, only queues event (no I/O is allowed there).
+	static int LIBUSB_CALL hotplugCallback(libusb_context *ctx, libusb_device *dev, libusb_hotplug_event event, void *userData);
+
+	// Open arrived and drop departed units, called by event thread.
+	void handleHotplugEvents();
+
+	// Single blocking bulk OUT transfer. Returns number of bytes written or negative libusb error.
+	int bulkOut(libusb_device_handle *dev, uint8_t *byteArray, uint32_t numberOfBytes);
+
+	// Receive answer to ready-wait status frame. Returns number of bytes received or negative libusb error.
+	int receiveReadyAnswer(slaveInfo &slave, libusb_device_handle *dev, StatusValue &status, uint32_t timeoutMs);
+
+	// Receive answer to timed out ready-wait status frame, if slave still owes it, waiting as long as that ready-wait.
+	// Afterwards nothing is owed, IN endpoint is reset if answer did not come. Returns negative libusb error on failure.
+	int discardReadyAnswer(slaveInfo &slave, libusb_device_handle *dev);
+
+	// Queue transaction for its device, start it immediately if device is idle.
+	void submitAsync(std::shared_ptr<AsyncTransaction> transaction);
+
+	// Submit all transfers of transaction. Returns false if none of them could be submitted.
+	static bool startTransaction(AsyncTransaction *transaction);
+
+	// Submit single transfer of transaction. Tail transfer of read is resubmitted until all bytes arrive.
+	static bool submitTransfer(AsyncTransaction *transaction, uint8_t endpoint, uint8_t *buffer, uint32_t length, bool tail = false);
+
+	// Free transfers and evaluate result, once all transfers of transaction completed.
+	static void completeTransaction(AsyncTransaction *transaction);
+
+	// Report transaction result and start next transaction queued for the same device.
+	void finishTransaction(AsyncTransaction *transaction, StatusValue status);
+
+	static void LIBUSB_CALL transferCallback(libusb_transfer *transfer);
+
+	void eventLoop();
+
+	// Known units, entries are never removed, so pointers cached in slaveInfo stay valid.
+	std::vector<std::unique_ptr<usbDevice>> devices;
+	std::vector<libusb_device_handle*> retiredHandles; // Handles of disconnected units, closed in destructor.
+	std::set<std::pair<uint16_t, uint16_t>> watchedIds; // VID/PID of requested slaves, hotplug opens matching units.
+	std::mutex devicesMutex;
 	libusb_context* ctx;
+
+	std::vector<HotplugEvent> hotplugEvents;
+	std::mutex hotplugMutex;
+	libusb_hotplug_callback_handle hotplugHandle;
+	bool hotplugEnabled;
+
+	// Asynchronous transactions waiting for each device, front one is in progress.
+	std::map<libusb_device_handle*, std::deque<std::shared_ptr<AsyncTransaction>>> asyncQueues;
+	std::mutex asyncMutex;
+	std::condition_variable asyncIdle;
+	uint32_t asyncPending;
+	std::thread eventThread;
+	std::atomic<bool> eventThreadRunning;
 };
 
@@ -25,9 +25,7 @@ void picoSlaveUSB::process() {
 }
 
 void picoSlaveUSB::bulkOutHandler(uint8_t itf, uint8_t const* buffer, uint16_t bufsize) {
-    for (uint16_t i = 0; i < bufsize; i++) {
-        writeHandler(buffer[i]);
-	}
+    writeHandler(buffer, bufsize);
 	
 #if CFG_TUD_VENDOR_RX_BUFSIZE > 0
     tud_vendor_read_flush();
@@ -35,26 +33,37 @@ void picoSlaveUSB::bulkOutHandler(uint8_t itf, uint8_t const* buffer, uint16_t b
 }
 
 void picoSlaveUSB::bulkInHandler() {
-    uint32_t txBufferSpace = tud_vendor_write_available();
-    if ( (bytesToSend > 0) && (txBufferSpace == ENDPOINT_BULK_SIZE) ) {
-        uint8_t trySend = (bytesToSend < txBufferSpace) ? bytesToSend : txBufferSpace;
-        uint8_t packet[ENDPOINT_BULK_SIZE] = {0};
+    // Keep tx FIFO full, so packets of a response are sent back to back. Until the last chunk of response
+    // only whole packets are queued, otherwise partially filled FIFO would be flushed as short packet
+    // and master would consider response finished.
+    while (bytesToSend > 0) {
+        uint32_t txBufferSpace = tud_vendor_write_available();
+        uint32_t trySend = (bytesToSend < ENDPOINT_BULK_SIZE) ? bytesToSend : ENDPOINT_BULK_SIZE;
 
-        for (uint8_t i = 0; i < trySend; i++) {
-            packet[i] = readHandler();
+        if (txBufferSpace < trySend) {
+            break;
         }
 
-        tud_vendor_write(packet, trySend);
-        tud_vendor_write_flush();
+        uint8_t packet[ENDPOINT_BULK_SIZE];
+        readHandler(packet, trySend);
 
+        tud_vendor_write(packet, trySend);
         bytesToSend -= trySend;
     }
+
+    tud_vendor_write_flush();
 }
 
 void picoSlaveUSB::sendToMaster(uint32_t nBytes) {
     bytesToSend += nBytes;
 }
 
+#if EMBEDDEDCOMM_STATS_TIMING
+uint32_t picoSlaveUSB::getTimeUs() {
+    return time_us_32();
+}
+#endif
+
 extern "C" void tud_vendor_rx_cb(uint8_t itf, uint8_t const* buffer, uint16_t bufsize) {
    picoSlaveUSB::get()->bulkOutHandler(itf, buffer, bufsize);
 }
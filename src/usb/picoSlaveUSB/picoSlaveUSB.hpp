@@ -45,6 +45,11 @@ protected:
 	// Invoked by parent class. Modify bytesToSend value.
 	void sendToMaster(uint32_t nBytes) override;
 
+#if EMBEDDEDCOMM_STATS_TIMING
+	// Statistics time source, hardware timer.
+	uint32_t getTimeUs() override;
+#endif
+
 private:
 	// Do not allow creating new objects. They will interfere with slaveUSB object.
 	picoSlaveUSB();
@@ -23,7 +23,7 @@ extern "C" {
 #define CFG_TUD_VENDOR              1
 #define CFG_TUD_VENDOR_EP_BUFSIZE  64
 #define CFG_TUD_VENDOR_RX_BUFSIZE  64
-#define CFG_TUD_VENDOR_TX_BUFSIZE  64
+#define CFG_TUD_VENDOR_TX_BUFSIZE  512 // Several packets, so large reads are not limited by process() rate.
 
 #define CFG_TUD_CDC     0
 #define CFG_TUD_MSC    	0